@@ -0,0 +1,110 @@
+/*=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+ MIT License
+
+ Copyright (c) 2022 Mikko Romppainen (kajakbros@gmail.com)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
+#pragma once
+#include <hungerland/math.h>
+#include <cstdint>
+#include <vector>
+#include <utility>
+
+namespace hungerland {
+namespace broadphase {
+
+	///
+	/// \brief The hungerland::broadphase::SpatialHash class
+	///
+	/// Uniform grid broadphase for dynamic objects, keyed on cell coordinates (cell size in tiles).
+	/// Objects are inserted each step and build() sorts them into hash buckets. Storage is reused
+	/// between steps, so rebuilding does not allocate once the buffers have grown.
+	///
+	/// @ingroup hungerland::broadphase
+	/// @author Mikko Romppainen (kajakbros@gmail.com)
+	///
+	class SpatialHash {
+	public:
+		typedef uint32_t Id;
+		typedef std::pair<Id, Id> Pair;
+
+		explicit SpatialHash(float cellSize = 1.0f, size_t numBuckets = 4096);
+
+		///
+		/// \brief clear removes all objects.
+		///
+		void clear();
+
+		///
+		/// \brief insert adds object with axis aligned bounding box to the hash. Call build() after inserting.
+		/// \param id User id of the object.
+		/// \param center
+		/// \param halfSize
+		///
+		void insert(Id id, const glm::vec2& center, const glm::vec2& halfSize);
+
+		///
+		/// \brief build sorts inserted objects into buckets.
+		///
+		void build();
+
+		///
+		/// \brief query returns ids of objects overlapping the region. Each id is reported once.
+		/// \param center
+		/// \param halfSize
+		/// \param result Cleared and filled with ids.
+		///
+		void query(const glm::vec2& center, const glm::vec2& halfSize, std::vector<Id>& result) const;
+
+		///
+		/// \brief findPairs returns all pairs of objects with overlapping bounding boxes. Each pair is reported
+		/// once, with the smaller id first.
+		/// \param pairs Cleared and filled with candidate pairs.
+		///
+		void findPairs(std::vector<Pair>& pairs) const;
+
+		size_t getNumObjects() const {
+			return m_objects.size();
+		}
+
+	private:
+		struct Object {
+			Id id;
+			glm::vec2 lo;
+			glm::vec2 hi;
+		};
+
+		struct CellEntry {
+			int2d_t cell;
+			uint32_t object;
+		};
+
+		int2d_t getCell(const glm::vec2& p) const;
+		size_t getBucket(int2d_t cell) const;
+
+		float					m_invCellSize;
+		std::vector<Object>		m_objects;
+		std::vector<CellEntry>	m_entries;			// Cell entries of all objects, sorted by bucket in build()
+		std::vector<CellEntry>	m_sortedEntries;
+		std::vector<uint32_t>	m_bucketStart;		// Start of each bucket in m_sortedEntries, size numBuckets+1
+	};
+
+}
+}
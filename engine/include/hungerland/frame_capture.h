@@ -0,0 +1,136 @@
+/*=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+ MIT License
+
+ Copyright (c) 2022 Mikko Romppainen (kajakbros@gmail.com)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+#include <stdio.h>
+
+namespace hungerland {
+namespace graphics {
+
+	///
+	/// \brief The hungerland::graphics::FrameCapture class reads frames back from the default or offscreen
+	/// framebuffer without stalling the render thread.
+	///
+	/// capture starts an asynchronous glReadPixels into one of a ring of pixel buffer objects and fences it.
+	/// Readbacks are mapped on a later frame, when their fence has signaled, and handed to a worker thread,
+	/// which fixes alpha, flips the rows and encodes PNG screenshots or appends frames to the recording file.
+	///
+	/// Recording writes frames as raw 8 bit RGBA, top row first, without headers. Frames are never dropped:
+	/// if all readbacks are in flight, capture waits for the oldest one. The frame size must not change during
+	/// recording, otherwise recording is stopped. Convert for example with
+	/// ffmpeg -f rawvideo -pixel_format rgba -video_size WxH -framerate 60 -i capture.raw capture.mp4
+	///
+	/// @ingroup hungerland::graphics
+	///
+	class FrameCapture {
+	public:
+		explicit FrameCapture(size_t numReadbacks = 3);
+		~FrameCapture();
+
+		///
+		/// \brief requestScreenshot saves the next captured frame as png.
+		/// \param filename
+		///
+		void requestScreenshot(const std::string& filename);
+
+		///
+		/// \brief startRecording opens file and starts recording all captured frames to it.
+		/// \param filename
+		/// \return false if the file can not be opened.
+		///
+		bool startRecording(const std::string& filename);
+
+		///
+		/// \brief stopRecording finishes frames in flight and closes the recording file.
+		///
+		void stopRecording();
+
+		bool isRecording() const;
+
+		///
+		/// \brief getNumRecordedFrames returns number of frames captured to the current or last recording.
+		///
+		size_t getNumRecordedFrames() const;
+
+		///
+		/// \brief capture finishes completed readbacks and reads the current frame from the bound framebuffer,
+		/// if a screenshot is requested or recording is on. Call on the render thread before swapping buffers.
+		/// \param width Framebuffer width.
+		/// \param height Framebuffer height.
+		///
+		void capture(int width, int height);
+
+	private:
+		struct Readback {
+			unsigned pbo = 0;
+			size_t capacity = 0;
+			void* fence = 0;	// GLsync
+			int width = 0;
+			int height = 0;
+			std::string screenshotFile;
+			bool record = false;
+		};
+
+		struct Job {
+			std::vector<uint8_t> pixels;	// Bottom row first, as read from GL
+			int width = 0;
+			int height = 0;
+			std::string screenshotFile;
+			FILE* recordFile = 0;
+			bool closeRecordFile = false;
+		};
+
+		bool finishOldest(bool wait);
+		void finishAll();
+		void pushJob(Job&& job);
+		void work();
+
+		std::vector<Readback>	m_readbacks;
+		std::deque<size_t>		m_pending;		// Readbacks in flight, oldest first
+		size_t					m_next;
+		std::string				m_screenshotFile;
+		FILE*					m_recordFile;	// Written and closed by the worker
+		int						m_recordWidth;
+		int						m_recordHeight;
+		size_t					m_numRecordedFrames;
+
+		std::mutex				m_mutex;		// Guards the members below
+		std::condition_variable	m_jobAvailable;
+		std::deque<Job>			m_jobs;
+		std::vector< std::vector<uint8_t> >	m_freePixels;	// Pixel buffers returned by the worker for reuse
+		bool					m_stopping;
+		std::thread				m_worker;
+
+		// Copy not allowed
+		FrameCapture(const FrameCapture&) = delete;
+		FrameCapture& operator=(const FrameCapture&) = delete;
+	};
+}
+}
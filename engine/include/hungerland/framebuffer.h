@@ -85,6 +85,7 @@ namespace graphics {
 		std::vector<unsigned>			m_drawBuffers;
 		unsigned						m_fboId;
 		unsigned                 m_rboId;
+		unsigned						m_previousFboId;	// Framebuffer bound before bind, restored by unbind
 
 		// Copy not allowed
 		FrameBuffer(const FrameBuffer&) = delete;
@@ -0,0 +1,106 @@
+/*=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+ MIT License
+
+ Copyright (c) 2022 Mikko Romppainen (kajakbros@gmail.com)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
+#pragma once
+#include <cstddef>
+
+namespace hungerland {
+namespace glstate {
+
+	///
+	/// \brief GL call counters of a frame.
+	///
+	struct Stats {
+		size_t glCalls = 0;			// GL calls issued by the engine
+		size_t skippedCalls = 0;	// Redundant state changes, which were not issued
+		size_t drawCalls = 0;
+	};
+
+	///
+	/// \brief Shadowed GL state. Engine code changes program, vertex array, texture bindings, blending and framebuffer
+	/// only through these functions, so calls that would not change the current state are skipped.
+	/// Deletions must also go through glstate, because GL names are reused.
+	///
+	void useProgram(unsigned program);
+	void bindVertexArray(unsigned vao);
+	void activeTexture(unsigned unit);
+
+	///
+	/// \brief bindTexture binds texture to the unit. Only GL_TEXTURE_2D and GL_TEXTURE_2D_ARRAY are shadowed.
+	///
+	void bindTexture(unsigned unit, unsigned target, unsigned texture);
+
+	///
+	/// \brief bindTexture binds texture to the current active unit, for example to change texture parameters.
+	///
+	void bindTexture(unsigned target, unsigned texture);
+	void setBlend(bool enabled);
+	void setBlendFunc(unsigned srcFactor, unsigned dstFactor);
+	void bindFramebuffer(unsigned fbo);
+
+	///
+	/// \brief getFramebuffer returns the bound framebuffer.
+	///
+	unsigned getFramebuffer();
+
+	///
+	/// \brief isBlendEnabled returns true if blending is enabled.
+	///
+	bool isBlendEnabled();
+
+	void deleteProgram(unsigned program);
+	void deleteVertexArray(unsigned vao);
+	void deleteTexture(unsigned texture);
+	void deleteFramebuffer(unsigned fbo);
+
+	///
+	/// \brief countCalls counts GL calls, which are not state changes, for example uniforms and buffer uploads.
+	///
+	void countCalls(size_t numCalls = 1);
+
+	///
+	/// \brief countDraw counts a draw call.
+	///
+	void countDraw();
+
+	///
+	/// \brief invalidate forgets shadowed state. Call after code outside of the engine has used GL.
+	///
+	void invalidate();
+
+	///
+	/// \brief nextFrame stores counters of the current frame and starts a new frame.
+	///
+	void nextFrame();
+
+	///
+	/// \brief getFrameStats returns counters of the last completed frame.
+	///
+	const Stats& getFrameStats();
+
+	///
+	/// \brief getFrameNumber returns number of frames started with nextFrame.
+	///
+	size_t getFrameNumber();
+}
+}
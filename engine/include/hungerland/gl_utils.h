@@ -23,10 +23,54 @@
 =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
 #pragma once
 
+// GL error checks are compiled in only when HUNGERLAND_GL_CHECKS is nonzero. CMake defines it for debug builds,
+// or for all builds with HUNGERLAND_GL_CHECKS_IN_RELEASE.
+#ifndef HUNGERLAND_GL_CHECKS
+#define HUNGERLAND_GL_CHECKS 0
+#endif
+
 namespace hungerland {
 
 	///
-	/// \brief checkGLError
+	/// \brief Runtime mode of compiled in GL error checks.
+	///
+	enum class GLErrorMode {
+		OFF,			// Checks do nothing
+		GET_ERROR,		// glGetError at each check
+		DEBUG_OUTPUT,	// KHR_debug callback. Errors are reported at the next check without driver round trips.
+	};
+
+	///
+	/// \brief initGLErrorChecks selects DEBUG_OUTPUT, if KHR_debug is available, and GET_ERROR otherwise.
+	/// Called by the window after the GL functions are loaded.
+	///
+	void initGLErrorChecks();
+
+	///
+	/// \brief setGLErrorMode
+	/// \param mode
+	///
+	void setGLErrorMode(GLErrorMode mode);
+
 	///
-	void checkGLError();
+	/// \brief getGLErrorMode
+	/// \return
+	///
+	GLErrorMode getGLErrorMode();
+
+	///
+	/// \brief clearGLErrors discards errors of GL calls, which are allowed to fail.
+	///
+	void clearGLErrors();
+
+	///
+	/// \brief checkGLErrorAt reports GL errors of previous GL calls with the engine call site. Use checkGLError().
+	///
+	void checkGLErrorAt(const char* file, int line);
 }
+
+#if HUNGERLAND_GL_CHECKS
+#define checkGLError() ::hungerland::checkGLErrorAt(__FILE__, __LINE__)
+#else
+#define checkGLError() ((void)0)
+#endif
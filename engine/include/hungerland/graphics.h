@@ -36,12 +36,30 @@ namespace shaders {
 
 	shader::Shader::Ref createTileLayer() ;
 
+	///
+	/// \brief createTileLayerArray creates tile layer shader, which samples all tilesets from one texture array.
+	/// \param maxTilesets Size of the per tileset uniform arrays.
+	///
+	shader::Shader::Ref createTileLayerArray(size_t maxTilesets);
+
 	shader::Shader::Ref createImageLayer();
 
 	shader::Shader::Ref createShade(const std::vector<shader::Constant>& constants, const std::string& fragmentShaderMain, const std::string& globals);
 
 	shader::Shader::Ref createSprite(const std::vector<shader::Constant>& constants, const std::string& surfaceShader, const std::string& globals);
 
+	///
+	/// \brief createSpriteBatch creates instanced sprite shader for graphics::SpriteBatch.
+	/// Surface shader modifies color, which is the texture color multiplied by the sprite tint.
+	///
+	shader::Shader::Ref createSpriteBatch(const std::vector<shader::Constant>& constants, const std::string& surfaceShader, const std::string& globals);
+
+	///
+	/// \brief createPostProcess creates fullscreen pass shader for graphics::PostProcessChain.
+	/// Surface shader modifies color, which is texture0 sampled at texCoord. texture1 and texelSize are also declared.
+	///
+	shader::Shader::Ref createPostProcess(const std::vector<shader::Constant>& constants, const std::string& surfaceShader, const std::string& globals);
+
 } // End - namespace shaders
 
 }
@@ -26,17 +26,15 @@
 #include <hungerland/math.h>
 #include <hungerland/texture.h>
 #include <map>
-
-namespace tmx {
-	class TileLayer;
-	class ImageLayer;
-	class Map;
-}
+#include <array>
+#include <unordered_map>
+#include <cstdint>
 
 namespace hungerland {
 	namespace shader {
 		class Shader;
 		class ShaderPass;
+		struct Uniform;
 	}
 
 	namespace texture {
@@ -45,6 +43,9 @@ namespace hungerland {
 	namespace mesh {
 		class Mesh;
 	}
+	namespace graphics {
+		class UniformBuffer;
+	}
 }
 
 namespace hungerland {
@@ -55,14 +56,47 @@ namespace map {
 		bool used = false;
 		//std::vector<float> tintColor;
 		glm::vec2 parallaxFactor = {1,1};
+		glm::vec4 rect = {0,0,0,0};		// Quad of the mesh: origin xy and size zw
+		glm::vec2 texScale = {1,1};		// Texture coordinates at the far corner of the quad
+	};
+
+	///
+	/// \brief The hungerland::map::DirtyRect struct
+	///
+	/// Inclusive rectangle [x0,x1]x[y0,y1] of tiles, which lookup texels must be uploaded.
+	///
+	struct DirtyRect {
+		size_t x0;
+		size_t y0;
+		size_t x1;
+		size_t y1;
 	};
 
 	struct TileSetSubset : public LayerSubset {
 		std::shared_ptr<mesh::Mesh> mesh;
 		std::shared_ptr<texture::Texture> tileMap;
-		std::shared_ptr<texture::Texture> colorLookup;
+		std::shared_ptr<texture::Texture> colorLookup;	// Lookup texture shared by all subsets of a layer or chunk
 		size2d_t tileSize = {0,0};
 		size2d_t tilesetSize  = {0,0};
+		int firstGID = 0;
+		int tileCount = 0;
+	};
+
+	///
+	/// \brief The hungerland::map::TilesetArray struct
+	///
+	/// All tilesets of a map as layers of one texture array, so that a tile layer can be drawn with a
+	/// single draw call. Tileset images smaller than the array layer are padded, uvScale maps tileset
+	/// texture coordinates to the array layer. Per tileset values are packed for the shader uniform arrays.
+	///
+	struct TilesetArray {
+		static constexpr size_t MAX_TILESETS = 16;
+		std::shared_ptr<texture::TextureArray> texture;
+		std::vector<int> firstGID;
+		std::vector<int> tileCount;
+		std::vector<float> tileSize;	// x,y per tileset
+		std::vector<float> tilesetSize;	// x,y per tileset
+		std::vector<float> uvScale;		// x,y per tileset
 	};
 
 	struct ObjectSubset : public LayerSubset {
@@ -82,23 +116,519 @@ namespace map {
 
 	typedef std::vector< std::pair<size2d_t,size_t> > Objects;
 	typedef std::vector< std::shared_ptr<texture::Texture> > Textures;
+	typedef std::vector<uint32_t> TileClasses;
+	typedef uint16_t TileClassBits;		// Class bits of one tile
+	static constexpr size_t MAX_TILE_CLASSES = 16;
+
+	///
+	/// \brief The hungerland::map::Grid class
+	///
+	/// Row-major contiguous storage of values for each tile of a layer.
+	///
+	template<typename T>
+	class Grid {
+	public:
+		Grid() : m_size{0,0} {}
+		Grid(size2d_t size, T value) {
+			resize(size, value);
+		}
+
+		void resize(size2d_t size, T value) {
+			m_size = size;
+			m_data.assign(size.x*size.y, value);
+		}
+
+		bool contains(size_t x, size_t y) const {
+			return x < m_size.x && y < m_size.y;
+		}
+
+		const T& get(size_t x, size_t y) const {
+			return m_data[y*m_size.x + x];
+		}
+
+		void set(size_t x, size_t y, T value) {
+			m_data[y*m_size.x + x] = value;
+		}
+
+		size2d_t getSize() const {
+			return m_size;
+		}
+
+		const T* getData() const {
+			return m_data.data();
+		}
+
+		T* getData() {
+			return m_data.data();
+		}
+
+	private:
+		size2d_t		m_size;
+		std::vector<T>	m_data;
+	};
+
+	///
+	/// \brief The hungerland::map::BitGrid class
+	///
+	/// Packed one bit per tile grid. Each row starts from a new 64 bit word, so
+	/// that 64 tiles of a row can be tested with a single word.
+	///
+	class BitGrid {
+	public:
+		typedef uint64_t Word;
+		static constexpr size_t WORD_BITS = 64;
+
+		BitGrid() : m_size{0,0}, m_stride(0) {}
+
+		void resize(size2d_t size);
+
+		bool contains(size_t x, size_t y) const {
+			return x < m_size.x && y < m_size.y;
+		}
+
+		bool get(size_t x, size_t y) const {
+			return (m_words[y*m_stride + x/WORD_BITS] >> (x%WORD_BITS)) & 1u;
+		}
 
+		void set(size_t x, size_t y, bool value);
+
+		///
+		/// \brief getWord returns 64 tiles of row y starting from tile x = wordIndex*64.
+		///
+		Word getWord(size_t wordIndex, size_t y) const {
+			return m_words[y*m_stride + wordIndex];
+		}
+
+		///
+		/// \brief any returns true if any bit inside inclusive rectangle [x0,x1]x[y0,y1] is set.
+		/// Rectangle is clipped to the grid.
+		///
+		bool any(size_t x0, size_t y0, size_t x1, size_t y1) const;
+
+		size2d_t getSize() const {
+			return m_size;
+		}
+
+		size_t getStride() const {
+			return m_stride;
+		}
+
+	private:
+		size2d_t			m_size;
+		size_t				m_stride;	// Words per row
+		std::vector<Word>	m_words;
+	};
+
+	///
+	/// Lookup textures are R32UI textures with one texel for each tile of a layer. Texel has global tile id in
+	/// the low bits and flip flags of the tile above LOOKUP_FLIP_SHIFT. All tilesets of a layer share the lookup.
+	///
+	static constexpr uint32_t LOOKUP_ID_MASK = 0x0FFFFFFFu;
+	static constexpr uint32_t LOOKUP_FLIP_SHIFT = 28;
+
+	///
+	/// \brief packTile returns lookup texel of a tile.
+	///
+	static inline uint32_t packTile(int tileId, int flipFlags) {
+		return (uint32_t(tileId) & LOOKUP_ID_MASK) | (uint32_t(flipFlags) << LOOKUP_FLIP_SHIFT);
+	}
+
+	///
+	/// \brief The hungerland::map::TileChunk struct
+	///
+	/// Rectangle of a tile layer. Resident chunks have tile grids, the solid tile bitmask and a GPU lookup texture.
+	/// Other chunks keep only their tiles packed as lookup texels. Grids are in chunk coordinates.
+	///
+	struct TileChunk {
+		size2d_t origin = {0,0};		// First tile of the chunk
+		size2d_t size = {0,0};			// Size in tiles
+		std::vector<uint32_t> packedTiles;	// Tiles as lookup texels, while chunk is not resident
+		Grid<int> tileIds;
+		Grid<uint8_t> tileFlags;
+		Grid<TileClassBits> tileClasses;	// Class bits of each tile (see Map::getTileClassMask)
+		BitGrid solidTiles;				// Bit set for each tile with id > 0
+		std::vector<TileSetSubset> subsets;	// Same indices as subsets of the layer
+		std::shared_ptr<texture::Texture> lookup;
+		std::vector<DirtyRect> dirtyRects;	// Edited tiles in chunk coordinates
+		bool resident = false;
+
+		///
+		/// \brief contains returns true, if layer tile x,y is inside the chunk.
+		///
+		bool contains(size_t x, size_t y) const {
+			// Tiles before the origin wrap to large values
+			return x - origin.x < size.x && y - origin.y < size.y;
+		}
+
+		///
+		/// \brief getTileId returns tile id of layer tile x,y, which must be inside the chunk.
+		///
+		int getTileId(size_t x, size_t y) const {
+			const auto lx = x - origin.x;
+			const auto ly = y - origin.y;
+			return resident ? tileIds.get(lx, ly) : int(packedTiles[ly*size.x + lx] & LOOKUP_ID_MASK);
+		}
+
+		///
+		/// \brief isSolid returns true, if layer tile x,y, which must be inside the chunk, has non zero tile id.
+		///
+		bool isSolid(size_t x, size_t y) const {
+			return resident ? solidTiles.get(x - origin.x, y - origin.y) : getTileId(x, y) > 0;
+		}
+	};
+
+	///
+	/// \brief The hungerland::map::ImageData struct
+	///
+	/// Decoded image, which is ready to be uploaded to a texture.
+	///
+	struct ImageData {
+		size2d_t size = {0,0};
+		unsigned channels = 0;
+		std::vector<uint8_t> pixels;
+	};
+
+	///
+	/// \brief The hungerland::map::TilesetData struct
+	///
+	struct TilesetData {
+		std::string imagePath;
+		size2d_t tileSize = {0,0};
+		size2d_t tilesetSize = {0,0};	// Columns and rows
+		int firstGID = 0;
+		int tileCount = 0;
+	};
+
+	///
+	/// \brief The hungerland::map::TileChunkData struct
+	///
+	/// Rectangle of tiles of a tile layer as lookup texels (see packTile), row by row.
+	///
+	struct TileChunkData {
+		size2d_t origin = {0,0};			// First tile in layer tile coordinates
+		size2d_t size = {0,0};
+		std::vector<uint32_t> tiles;
+		const uint32_t* mappedTiles = 0;	// Tiles in memory mapped baked map, used instead of tiles if set
+
+		const uint32_t* getTiles() const {
+			return mappedTiles != 0 ? mappedTiles : tiles.data();
+		}
+	};
+
+	///
+	/// \brief The hungerland::map::TileLayerData struct
+	///
+	/// Tile layer contents independent of the map file format. Tiles are stored only for chunks, which exist in
+	/// the map: finite maps have one chunk covering the layer, infinite maps have the chunks of the map file.
+	///
+	struct TileLayerData {
+		std::string name;
+		float opacity = 1.0f;
+		int2d_t offset = {0,0};
+		size2d_t size = {0,0};				// Layer size in tiles
+		std::vector<TileChunkData> chunks;	// Tiles outside of chunks are empty
+	};
+
+	///
+	/// \brief The hungerland::map::ImageLayerData struct
+	///
+	struct ImageLayerData {
+		std::string name;
+		std::string imagePath;
+		float opacity = 1.0f;
+		int2d_t offset = {0,0};
+		size2d_t repeat = {0,0};
+		glm::vec2 parallaxFactor = {1,1};
+		std::vector<float> transparentColor;
+	};
+
+	///
+	/// \brief The hungerland::map::MapData struct
+	///
+	/// Map contents without GPU resources. Created from tmx-maps with loadTmx or from baked maps
+	/// with bake::read, and used to create Map.
+	///
+	struct MapData {
+		size2d_t mapSize = {0,0};
+		size2d_t tileSize = {0,0};
+		int2d_t tileOrigin = {0,0};			// Tiled tile coordinates of tile 0,0 of the layer grids. Negative for infinite maps with chunks left or above of the origin.
+		glm::vec4 bounds = glm::vec4(0);	// Left, top, width and height in pixels
+		glm::vec4 clearColor = glm::vec4(0.5f,0.5f,0.5f,1.0f);
+		bool infinite = false;
+		std::vector<TilesetData> tilesets;
+		std::map<std::string, size_t> tileClassBits;
+		TileClasses classesByTileId;
+		std::vector<TileLayerData> tileLayers;
+		std::vector<ImageLayerData> imageLayers;
+		std::vector< std::array<size_t,2> > layers;	// Layer order: {0 = tile layer, 1 = image layer, index}
+	};
+
+	///
+	/// \brief loadTmx reads map data from Tiled tmx-map file.
+	/// \param mapFilename
+	/// \return
+	///
+	MapData loadTmx(const std::string& mapFilename);
+
+	///
+	/// \brief fillLookup writes lookup texels of tiles in rectangle of tile grids row by row to preallocated lookup.
+	/// \param lookup Buffer of at least size.x*size.y texels.
+	///
+	void fillLookup(uint32_t* lookup, const Grid<int>& tileIds, const Grid<uint8_t>& tileFlags, size2d_t origin, size2d_t size);
+
+	///
+	/// \brief The hungerland::map::TileLayer class
+	///
+	/// Tiles are stored in chunks (see TileChunk). A layer, which is not chunked, has one resident chunk covering
+	/// the layer. Chunked layers have chunks only where the map has tiles, and only chunks made resident by
+	/// Map::updateChunks keep tile grids, solid tile bitmask and lookup texture, about 7 bytes and one bit per tile.
+	/// Other chunks keep 4 bytes per tile. Tile and collision queries work on all chunks, but scan packed tiles
+	/// of non resident chunks.
+	///
 	class TileLayer {
 	public:
 		Textures textures;
-		Objects	objects;
-		std::vector<TileSetSubset>	subsets;
-		std::vector< std::vector<int> > tileIds;
-		std::vector< std::vector<int> > tileFlags;
-		TileLayer(const tmx::Map& map, size_t layerIndex, const Textures& tilesetTextures);
+		Objects	objects;	// Non zero tiles of non chunked layer. Chunked layers have no objects.
+		std::vector<TileSetSubset>	subsets;	// Subsets of all tilesets, which chunk subsets are copied from
+		size_t chunkSize;			// Chunk width and height in tiles, or 0 if layer is one chunk
+		size2d_t numChunks;
+		std::vector<TileChunk> chunks;	// Chunks, which have tiles, in creation order
+		std::shared_ptr<const TilesetArray> tilesetArray;	// Set by the map, if all tilesets fit to one texture array
+		TileLayer(const MapData& map, size_t layerIndex, const Textures& tilesetTextures, size_t chunkSize = 0);
 		void setObjects(const Objects& objs);
+
+		///
+		/// \brief getSize returns layer size in tiles.
+		///
+		size2d_t getSize() const {
+			return m_size;
+		}
+
+		///
+		/// \brief findChunk returns chunk containing tile x,y, or 0 if tile is outside the layer or has no chunk.
+		///
+		const TileChunk* findChunk(size_t x, size_t y) const;
+
+		///
+		/// \brief getTileId returns tile id at x,y, or -1 if x,y is outside the layer.
+		///
+		int getTileId(size_t x, size_t y) const;
+
+		///
+		/// \brief isSolid returns true, if tile at x,y has non zero tile id.
+		///
+		bool isSolid(size_t x, size_t y) const;
+
+		///
+		/// \brief isAnySolid returns true if any tile in inclusive rectangle [x0,x1]x[y0,y1] is solid.
+		/// Rectangle is clipped to the layer.
+		///
+		bool isAnySolid(size_t x0, size_t y0, size_t x1, size_t y1) const;
+
+		///
+		/// \brief getTileClasses returns class bits of tile at x,y.
+		///
+		uint32_t getTileClasses(size_t x, size_t y) const;
+
+		///
+		/// \brief setTile changes tile at x,y. Lookup textures are updated with flush.
+		/// Objects are not updated, use getTileId for current tiles.
+		/// \param x
+		/// \param y
+		/// \param tileId Tile gid, or 0 to clear the tile.
+		/// \param flipFlags
+		///
+		void setTile(size_t x, size_t y, int tileId, int flipFlags = 0);
+
+		///
+		/// \brief fillRect sets all tiles in rectangle, which is clipped to the layer.
+		///
+		void fillRect(size_t x, size_t y, size_t width, size_t height, int tileId, int flipFlags = 0);
+
+		///
+		/// \brief flush uploads dirty rectangles of edited tiles to lookup texture with glTexSubImage2D.
+		/// Call once per frame before drawing.
+		///
+		void flush();
+
+		///
+		/// \brief setChunkResident unpacks tiles of a chunk to tile grids and creates its GPU lookup texture,
+		/// or packs the tiles and releases grids and lookup texture.
+		/// \param chunkIndex
+		/// \param resident
+		///
+		void setChunkResident(size_t chunkIndex, bool resident);
+
+	private:
+		size_t createChunk(size_t cx, size_t cy);
+		void setChunkTile(TileChunk& chunk, size_t lx, size_t ly, int tileId, int flipFlags);
+		TileClassBits getClassBits(int tileId) const;
+		int findSubset(int tileId) const;
+		void markUsedSubsets(TileChunk& chunk) const;
+		void uploadDirtyRects(TileChunk& chunk);
+		size2d_t m_size;
+		size_t m_chunkExtent;		// chunkSize, or size of the only chunk of non chunked layer
+		std::unordered_map<size_t, size_t> m_chunkIndices;	// Index to chunks by cy*numChunks.x + cx
+		std::vector<int> m_subsetByGid;		// Subset index of each tile gid, or -1
+		std::vector<uint32_t> m_uploadBuffer;
+		TileClasses m_classesByTileId;
+		glm::vec2 m_boundsOrigin;	// Map bounds top left in pixels
+		size2d_t m_tileSizePixels;
 	};
 
 	class ImageLayer {
 	public:
 		ImageSubset subset;
-		const tmx::ImageLayer* tmxLayer;
-		ImageLayer(const tmx::Map& map, size_t layerIndex, const std::vector< std::shared_ptr<texture::Texture> >& mapTextures);
+		ImageLayer(const MapData& map, size_t layerIndex, std::shared_ptr<texture::Texture> texture);
+	};
+
+	///
+	/// \brief The hungerland::map::CollisionGrid class
+	///
+	/// Fixed size 3x3 tile neighbourhood collision result, indexed as [y][x] like Map::MapCollision.
+	/// Components are overlap depths, or -1 where there is no overlap. Lives on the stack.
+	///
+	struct CollisionGrid {
+		typedef std::array<glm::vec3, 3> Row;
+
+		CollisionGrid() {
+			for(auto& row : cells) {
+				row.fill(glm::vec3(-1));
+			}
+		}
+
+		static constexpr size_t size() {
+			return 3;
+		}
+
+		Row& operator[](size_t y) {
+			return cells[y];
+		}
+
+		const Row& operator[](size_t y) const {
+			return cells[y];
+		}
+
+		std::array<Row, 3> cells;
+	};
+
+	///
+	/// \brief The hungerland::map::RayHit class
+	///
+	/// Result of Map::raycast. Distance is measured in tiles along the normalized ray direction
+	/// and normal is the normal of the tile face the ray entered through ({0,0} if ray starts inside a tile).
+	///
+	struct RayHit {
+		bool hit = false;
+		int2d_t tile = {-1,-1};
+		float distance = 0.0f;
+		glm::vec2 normal = glm::vec2(0);
+	};
+
+	///
+	/// \brief The hungerland::map::SweepHit class
+	///
+	/// Result of Map::sweepAABB. Time is fraction of the displacement travelled before impact and
+	/// position is the box position at that time, snapped exactly to the touched face along the normal.
+	/// Tile is {-1,-1} if the box hit the map border.
+	///
+	struct SweepHit {
+		bool hit = false;
+		float time = 1.0f;
+		glm::vec3 position = glm::vec3(0);
+		glm::vec2 normal = glm::vec2(0);
+		int2d_t tile = {-1,-1};
+	};
+
+	///
+	/// \brief The hungerland::map::RayBatch class
+	///
+	/// Rays in structure of arrays form for Map::raycastBatch. Directions does not need to be normalized.
+	///
+	struct RayBatch {
+		std::vector<float> originX;
+		std::vector<float> originY;
+		std::vector<float> directionX;
+		std::vector<float> directionY;
+		std::vector<float> maxDistance;
+
+		size_t size() const {
+			return originX.size();
+		}
+
+		void clear() {
+			originX.clear();
+			originY.clear();
+			directionX.clear();
+			directionY.clear();
+			maxDistance.clear();
+		}
+
+		void push_back(const glm::vec2& origin, const glm::vec2& direction, float maxDist) {
+			originX.push_back(origin.x);
+			originY.push_back(origin.y);
+			directionX.push_back(direction.x);
+			directionY.push_back(direction.y);
+			maxDistance.push_back(maxDist);
+		}
+	};
+
+	///
+	/// \brief The hungerland::map::RayHitBatch class
+	///
+	/// Results of Map::raycastBatch in structure of arrays form. Element i is the result of ray i.
+	///
+	struct RayHitBatch {
+		std::vector<uint8_t> hit;
+		std::vector<int> tileX;
+		std::vector<int> tileY;
+		std::vector<float> distance;
+		std::vector<float> normalX;
+		std::vector<float> normalY;
+
+		size_t size() const {
+			return hit.size();
+		}
+
+		void resize(size_t n) {
+			hit.resize(n);
+			tileX.resize(n);
+			tileY.resize(n);
+			distance.resize(n);
+			normalX.resize(n);
+			normalY.resize(n);
+		}
+
+		RayHit get(size_t i) const {
+			RayHit res;
+			res.hit = hit[i] != 0;
+			res.tile = {tileX[i], tileY[i]};
+			res.distance = distance[i];
+			res.normal = glm::vec2(normalX[i], normalY[i]);
+			return res;
+		}
+	};
+
+	///
+	/// \brief The hungerland::map::LayerUniforms struct
+	///
+	/// Uniforms of a map layer shader resolved once, when the map is created, so that drawing does not look up
+	/// uniforms by name. Uniforms, which the shader does not have, are 0.
+	///
+	struct LayerUniforms {
+		LayerUniforms() = default;
+		explicit LayerUniforms(const shader::Shader& shader);
+		const shader::Uniform* lookupMap = 0;
+		const shader::Uniform* tileMap = 0;
+		const shader::Uniform* tileMaps = 0;
+		const shader::Uniform* numTilesets = 0;
+		const shader::Uniform* firstGID = 0;
+		const shader::Uniform* tileCount = 0;
+		const shader::Uniform* tileSize = 0;
+		const shader::Uniform* tilesetSize = 0;
+		const shader::Uniform* uvScale = 0;
+		const shader::Uniform* image = 0;
+		const shader::Uniform* repeat = 0;
 	};
 
 	///
@@ -108,16 +638,145 @@ namespace map {
 	public:
 		typedef std::function<std::shared_ptr<texture::Texture>(const std::string&)> LoadTextureFuncType;
 
-		Map(const std::string& mapFilename, LoadTextureFuncType loadTexture);
+		///
+		/// Returns decoded image of the file, or 0 if the image is not available on CPU. Image must stay alive
+		/// until the map constructor returns.
+		///
+		typedef std::function<const ImageData*(const std::string&)> GetImageFuncType;
+
+		///
+		/// \brief Map
+		/// \param mapFilename
+		/// \param loadTexture
+		/// \param chunkSize If non zero, tile layers are split to chunks of chunkSize x chunkSize tiles, and only
+		/// chunks near the view (see updateChunks) have tile grids and GPU lookup textures. Chunks are created only
+		/// where the map has tiles. Infinite maps are always chunked.
+		///
+		/// Map file can be a tmx-map or a map baked with hungerland_mapbake (see bake::write). Baked maps are
+		/// memory mapped and tiles are copied to chunks from the mapping without parsing.
+		///
+		/// \param getImage If all tileset images are available as decoded RGBA images, tilesets are uploaded to one
+		/// texture array and tile layers are drawn with one draw call. Tileset textures are not loaded then.
+		/// Otherwise tilesets are loaded with loadTexture and drawn with one draw call per used tileset.
+		///
+		Map(const std::string& mapFilename, LoadTextureFuncType loadTexture, size_t chunkSize = 0, GetImageFuncType getImage = 0);
+
+		///
+		/// \brief Map creates map from map data.
+		/// \param mapData
+		/// \param loadTexture
+		/// \param chunkSize
+		/// \param getImage
+		///
+		Map(const MapData& mapData, LoadTextureFuncType loadTexture, size_t chunkSize = 0, GetImageFuncType getImage = 0);
+
+		///
+		/// \brief updateChunks streams chunks of chunked tile layers: chunks overlapping the view extended with margin
+		/// are made resident and all other chunks are released. Does nothing for non chunked layers.
+		/// \param viewCenter View center in tile coordinates.
+		/// \param viewHalfSize Half size of view in tiles.
+		/// \param margin Extra tiles around the view to keep resident.
+		///
+		void updateChunks(const glm::vec2& viewCenter, const glm::vec2& viewHalfSize, float margin = 8.0f);
+
+		///
+		/// \brief getNumResidentChunks
+		/// \return Number of resident chunks in all tile layers.
+		///
+		size_t getNumResidentChunks() const;
 
 		size2d_t getMapSize() const;
 		size2d_t getTileSize() const;
+
+		///
+		/// \brief getTileOrigin returns Tiled tile coordinates of tile 0,0. Tile coordinates of the map start from
+		/// the top left tile of all chunks of infinite maps, so Tiled tile x,y is at x-getTileOrigin().x, y-getTileOrigin().y.
+		/// Always 0,0 for finite maps.
+		///
+		int2d_t getTileOrigin() const;
 		const size_t getNumLayers() const;
 		size_t getLayerIndex(const std::string& name) const;
 
 		int getTileId(size_t layerId, size_t x, size_t y) const;
 		const Objects& getLayerObjects(size_t layerId) const;
 
+		///
+		/// \brief isSolid returns true, if tile at x,y of tile layer has non zero tile id.
+		///
+		bool isSolid(size_t layerId, size_t x, size_t y) const;
+
+		///
+		/// \brief isAnySolid returns true if any tile in inclusive rectangle [x0,x1]x[y0,y1] is solid.
+		/// Tests 64 tiles of a row at once using the solid tile bit grid of the layer.
+		///
+		bool isAnySolid(size_t layerId, size_t x0, size_t y0, size_t x1, size_t y1) const;
+
+		///
+		/// \brief getTileClasses returns class bits of tile at x,y. Test against getTileClassMask.
+		///
+		uint32_t getTileClasses(size_t layerId, size_t x, size_t y) const;
+
+		///
+		/// \brief getTileClassMask returns bit mask of tile class, which is set from tileset tile class
+		/// or from true valued boolean tile property with given name. Returns 0 for unknown classes.
+		///
+		uint32_t getTileClassMask(const std::string& className) const;
+
+		const TileLayer& getTileLayer(size_t layerId) const;
+		TileLayer& getTileLayer(size_t layerId);
+
+		///
+		/// \brief setTile changes tile of a tile layer. See TileLayer::setTile.
+		///
+		void setTile(size_t layerId, size_t x, size_t y, int tileId, int flipFlags = 0);
+
+		///
+		/// \brief fillRect sets all tiles in rectangle of a tile layer. See TileLayer::fillRect.
+		///
+		void fillRect(size_t layerId, size_t x, size_t y, size_t width, size_t height, int tileId, int flipFlags = 0);
+
+		///
+		/// \brief flushTileEdits uploads edited tiles of all tile layers to lookup textures.
+		/// Call once per frame before drawing.
+		///
+		void flushTileEdits();
+
+		///
+		/// \brief raycast walks solid tiles of a tile layer along a ray using DDA traversal (Amanatides-Woo).
+		/// \param layerId Tile layer handle resolved with getLayerIndex.
+		/// \param origin Ray origin in tile coordinates (tile x,y covers x-0.5..x+0.5, y-0.5..y+0.5).
+		/// \param direction Ray direction. Does not need to be normalized.
+		/// \param maxDistance Maximum distance in tiles to trace.
+		/// \return First solid tile hit.
+		///
+		RayHit raycast(size_t layerId, const glm::vec2& origin, const glm::vec2& direction, float maxDistance) const;
+
+		///
+		/// \brief raycastBatch traces all rays against a tile layer. Output is resized to the number of rays,
+		/// so it can be reused between calls without allocations.
+		/// \param layerId Tile layer handle resolved with getLayerIndex.
+		/// \param rays
+		/// \param hits
+		///
+		void raycastBatch(size_t layerId, const RayBatch& rays, RayHitBatch& hits) const;
+
+		///
+		/// \brief sweepAABB moves box along displacement and returns the first solid tile or map border it hits.
+		/// Only tiles inside the swept area are tested, so fast moving boxes can not tunnel through tiles.
+		/// Boxes touching a tile are not blocked when sliding along or moving away from it.
+		/// \param layerId Tile layer handle resolved with getLayerIndex.
+		/// \param position Box center in tile coordinates.
+		/// \param halfSize Half size of the box.
+		/// \param displacement Movement of the box.
+		/// \return Time of impact, contact normal and the tile hit.
+		///
+		SweepHit sweepAABB(size_t layerId, const glm::vec3& position, const glm::vec3& halfSize, const glm::vec3& displacement) const;
+
+		///
+		/// \brief hasLineOfSight returns true, if there is no solid tile between from and to.
+		///
+		bool hasLineOfSight(size_t layerId, const glm::vec2& from, const glm::vec2& to) const;
+
 		const auto& getImageLayers() const {
 			return m_bgLayers;
 		}
@@ -135,23 +794,45 @@ namespace map {
 		}
 
 		typedef std::vector< std::vector<glm::vec3> > MapCollision;
+		typedef CollisionGrid FixedMapCollision;
 
 		MapCollision checkCollision(const std::string& layerName, const glm::vec3 position, glm::vec3 halfSize) const;
 
+		///
+		/// \brief checkCollision without heap allocations.
+		/// \param layerId Tile layer handle resolved once with getLayerIndex.
+		/// \param position
+		/// \param halfSize
+		/// \return 3x3 collision neighbourhood around position.
+		///
+		FixedMapCollision checkCollision(size_t layerId, const glm::vec3 position, glm::vec3 halfSize) const;
+
 
 	public:
 		std::shared_ptr<shader::Shader>						m_tileLayerShader;
+		std::shared_ptr<shader::Shader>						m_tileLayerArrayShader;	// Only if tilesets are in a texture array
 		std::shared_ptr<shader::Shader>						m_imageLayerShader;
+		LayerUniforms										m_tileLayerUniforms;
+		LayerUniforms										m_tileLayerArrayUniforms;
+		LayerUniforms										m_imageLayerUniforms;
+		std::shared_ptr<graphics::UniformBuffer>			m_uniformBuffer;	// FrameData and LayerData blocks of draws
 		//std::shared_ptr<mesh::Mesh>							m_mapMesh;
 	private:
+		void create(const MapData& mapData, LoadTextureFuncType loadTexture, size_t chunkSize, GetImageFuncType getImage);
+		bool createTilesetArray(const MapData& mapData, GetImageFuncType getImage);
+
 		glm::vec4											m_clearColor;
-		std::shared_ptr<tmx::Map>							m_map;
-		std::vector< std::shared_ptr<texture::Texture> >	m_tilesetTextures;
+		size2d_t											m_mapSize;
+		int2d_t												m_tileOrigin;
+		size2d_t											m_tileSize;
+		std::vector< std::shared_ptr<texture::Texture> >	m_tilesetTextures;	// Empty textures if tilesets are in m_tilesetArray
+		std::shared_ptr<const TilesetArray>					m_tilesetArray;
 		std::vector< std::shared_ptr<texture::Texture> >	m_imageTextures;
 		std::vector< std::shared_ptr<TileLayer> >			m_tileLayers;
 		std::vector< std::shared_ptr<ImageLayer> >			m_bgLayers;
 		std::map<std::string, size_t> m_layerNames;
 		std::vector< std::array<size_t,2> > m_allLayersMap;
+		std::map<std::string, size_t> m_tileClassBits;
 	};
 
 
@@ -216,18 +897,27 @@ namespace map {
 	///
 	bool isPenetrating(const Map::MapCollision& col);
 
+	///
+	/// \brief isPenetrating
+	/// \param col
+	/// \return
+	///
+	bool isPenetrating(const Map::FixedMapCollision& col);
+
 	///
 	/// \brief hungerland::map::load
 	/// \param f
 	/// \param mapFile
+	/// \param repeat
+	/// \param chunkSize
 	///
 	template<typename MapType, typename LoadTextureFunc>
-	std::shared_ptr<MapType> load(LoadTextureFunc loadTexture, const std::string& mapFile, bool repeat) {
+	std::shared_ptr<MapType> load(LoadTextureFunc loadTexture, const std::string& mapFile, bool repeat, size_t chunkSize = 0) {
 		return std::make_shared<MapType>(mapFile, [loadTexture,repeat](const std::string& imageFile) {
 			auto texture = loadTexture(imageFile);
 			texture->setRepeat(repeat);
 			return texture;
-		});
+		}, chunkSize);
 	}
 
 	///
@@ -0,0 +1,108 @@
+/*=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+ MIT License
+
+ Copyright (c) 2022 Mikko Romppainen (kajakbros@gmail.com)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
+#pragma once
+#include <hungerland/map.h>
+#include <string>
+#include <cstdint>
+
+namespace hungerland {
+namespace map {
+namespace bake {
+	///
+	/// Baked map file format version. Increase when the format changes, old files must then be baked again.
+	///
+	/// File is stored in native byte order and all fields are 4 byte aligned, so that tiles can be used
+	/// directly from the memory mapped file:
+	///		- Header
+	///		- Tilesets: image path, tile size, tileset size, first gid, tile count
+	///		- Tile classes: name, bit
+	///		- Class bits of each tile id
+	///		- Layers in drawing order: type, name, opacity, offset and
+	///			- Tile layer: size, number of chunks and for each existing chunk: origin, size and
+	///			  tiles as R32UI lookup texels (see packTile)
+	///			- Image layer: image path, repeat, parallax factor, transparent color
+	///
+	/// Image paths are stored relative to the baked map file.
+	///
+	static constexpr uint32_t VERSION = 4;
+
+	///
+	/// \brief The hungerland::map::bake::MappedFile class
+	///
+	/// Read only memory mapping of a file. File is unmapped when object is destroyed.
+	///
+	class MappedFile {
+	public:
+		explicit MappedFile(const std::string& filename);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		const uint8_t* getData() const {
+			return m_data;
+		}
+
+		size_t getSize() const {
+			return m_size;
+		}
+
+		const std::string& getFilename() const {
+			return m_filename;
+		}
+
+	private:
+		std::string		m_filename;
+		const uint8_t*	m_data;
+		size_t			m_size;
+#if defined(_WIN32)
+		void*			m_file;
+		void*			m_mapping;
+#endif
+	};
+
+	///
+	/// \brief isBakedMap returns true, if file starts with baked map file magic.
+	/// \param filename
+	///
+	bool isBakedMap(const std::string& filename);
+
+	///
+	/// \brief write bakes map data to file.
+	/// \param mapData
+	/// \param filename
+	///
+	void write(const MapData& mapData, const std::string& filename);
+
+	///
+	/// \brief read reads map data from memory mapped baked map file.
+	/// Tiles of returned map data point to the mapping, so file must be kept mapped while map data is used.
+	/// \param file
+	/// \return
+	///
+	MapData read(const MappedFile& file);
+
+} // End - namespace bake
+} // End - namespace map
+} // End - namespace hungerland
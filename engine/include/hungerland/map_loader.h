@@ -0,0 +1,101 @@
+/*=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+ MIT License
+
+ Copyright (c) 2022 Mikko Romppainen (kajakbros@gmail.com)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
+#pragma once
+#include <hungerland/map.h>
+#include <future>
+#include <functional>
+
+namespace hungerland {
+namespace map {
+namespace bake {
+	class MappedFile;
+}
+
+	///
+	/// Decodes image file. Called from worker threads, so it must not use GL.
+	///
+	typedef std::function<ImageData(const std::string&)> DecodeImageFuncType;
+
+	///
+	/// \brief The hungerland::map::PreparedMap struct
+	///
+	/// Map data with decoded images, created by prepareAsync on worker threads. Tiles of tile layers are
+	/// already packed to lookup texels by the map reader.
+	/// Only GPU uploads are left to do, which are done on the GL context thread with create.
+	///
+	struct PreparedMap {
+		MapData data;
+		size_t chunkSize = 0;
+		std::map<std::string, ImageData> images;
+		std::shared_ptr<bake::MappedFile> bakedFile;		// Keeps tiles of baked maps mapped
+
+		///
+		/// \brief createTexture uploads decoded image to a new texture. Must be called from GL context thread.
+		/// \param filename
+		/// \return Texture, or 0 if image was not decoded.
+		///
+		std::shared_ptr<texture::Texture> createTexture(const std::string& filename) const;
+
+		///
+		/// \brief getImage returns decoded image of the file, or 0 if image was not decoded.
+		///
+		const ImageData* getImage(const std::string& filename) const;
+	};
+
+	///
+	/// \brief prepareAsync reads map file and decodes tileset and image layer images on worker threads.
+	/// Each image is decoded in its own task.
+	/// Poll the returned future and call create when it is ready.
+	/// \param mapFilename Tmx-map or baked map file.
+	/// \param decodeImage
+	/// \param chunkSize See Map::Map.
+	/// \return Future of prepared map. Loading errors are rethrown from future::get.
+	///
+	std::future< std::shared_ptr<PreparedMap> > prepareAsync(const std::string& mapFilename, DecodeImageFuncType decodeImage, size_t chunkSize = 0);
+
+	///
+	/// \brief hungerland::map::create creates map from prepared map. Must be called from GL context thread.
+	/// \param prepared
+	/// \param repeat
+	///
+	template<typename MapType>
+	std::shared_ptr<MapType> create(const PreparedMap& prepared, bool repeat) {
+		std::map<std::string, std::shared_ptr<texture::Texture> > textures;
+		return std::make_shared<MapType>(prepared.data, [&prepared, &textures, repeat](const std::string& imageFile) {
+			auto it = textures.find(imageFile);
+			if(it != textures.end()) {
+				return it->second;
+			}
+			auto texture = prepared.createTexture(imageFile);
+			if(texture != 0) {
+				texture->setRepeat(repeat);
+			}
+			return textures[imageFile] = texture;
+		}, prepared.chunkSize, [&prepared](const std::string& imageFile) {
+			return prepared.getImage(imageFile);
+		});
+	}
+
+} // End - namespace map
+} // End - namespace hungerland
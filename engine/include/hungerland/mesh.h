@@ -43,7 +43,12 @@ namespace mesh {
 		~Mesh();
 		unsigned vao;
 		unsigned vbos[2];
+		size_t vboSizes[2] = {0, 0};	// Allocated bytes of vbos
 
+		///
+		/// \brief setVBOData sets vertex data of an attribute. Storage is reallocated only if the data does not fit,
+		/// otherwise it is updated in place. For geometry, which changes every frame, use graphics::StreamBuffer.
+		///
 		void setVBOData(int index, const std::vector<float>& data, size_t numComponents, bool dynamic = false);
 		void setVBOData(int index, const std::vector<glm::vec2>& data, bool dynamic = false);
 	};
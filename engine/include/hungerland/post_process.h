@@ -0,0 +1,164 @@
+/*=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+ MIT License
+
+ Copyright (c) 2022 Mikko Romppainen (kajakbros@gmail.com)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
+#pragma once
+#include <hungerland/shader.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace hungerland {
+namespace texture {
+	class Texture;
+}
+namespace mesh {
+	class Mesh;
+}
+namespace graphics {
+	class FrameBuffer;
+
+	///
+	/// \brief The hungerland::graphics::RenderTargetPool class
+	///
+	/// Keeps framebuffers with one color texture keyed by size and format. Released targets are handed out again
+	/// by acquire, so render targets of post processing are allocated only when the first frame needs them.
+	///
+	/// @ingroup hungerland::graphics
+	///
+	class RenderTargetPool {
+	public:
+		enum class Format {
+			RGBA8,		// 8 bit unsigned normalized
+			RGBA32F,	// 32 bit float, for HDR passes
+		};
+
+		struct Target {
+			std::unique_ptr<FrameBuffer> frameBuffer;
+			std::shared_ptr<texture::Texture> texture;
+			unsigned width = 0;
+			unsigned height = 0;
+			Format format = Format::RGBA8;
+			bool inUse = false;
+			size_t lastUsedFrame = 0;
+		};
+
+		RenderTargetPool();
+		~RenderTargetPool();
+
+		///
+		/// \brief acquire returns free target of the size and format, or creates a new one.
+		/// Target is in use until release. Target textures use linear filtering and clamp to edge.
+		///
+		Target* acquire(unsigned width, unsigned height, Format format);
+
+		///
+		/// \brief release returns target to the pool.
+		///
+		void release(Target* target);
+
+		///
+		/// \brief trim deletes free targets, which have not been acquired during last maxUnusedFrames frames.
+		/// Call for example after window resize to free targets of the old size.
+		///
+		void trim(size_t maxUnusedFrames = 0);
+
+		size_t getNumTargets() const;
+
+	private:
+		std::vector<std::unique_ptr<Target> > m_targets;
+
+		// Copy not allowed
+		RenderTargetPool(const RenderTargetPool&) = delete;
+		RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+	};
+
+	///
+	/// \brief The hungerland::graphics::PostProcessChain class
+	///
+	/// Applies named fullscreen passes one after another. Shader programs of the passes are created once by
+	/// addPass (see shaders::createPostProcess) and render targets come from a RenderTargetPool, so applying the
+	/// chain does not compile shaders or allocate GL objects after the first frame. Each pass renders into its own
+	/// pooled target and reads output of the previous pass, so passes of same size ping-pong between two targets.
+	///
+	/// Pass shader modifies color, which is the previous pass output sampled at texCoord. Available uniforms:
+	/// texture0 (previous pass output), texture1 (input of the chain) and texelSize (1 / size of the pass target).
+	///
+	/// @ingroup hungerland::graphics
+	///
+	class PostProcessChain {
+	public:
+		explicit PostProcessChain(std::shared_ptr<RenderTargetPool> pool = std::make_shared<RenderTargetPool>());
+		~PostProcessChain();
+
+		///
+		/// \brief addPass adds pass to the end of the chain.
+		/// \param name Name of the pass used by setEnabled and setConstants.
+		/// \param shader Surface shader of the pass.
+		/// \param resolutionScale Size of the pass target relative to the chain input, e.g. 0.5 for half resolution blur.
+		/// \param constants Uniforms of the pass and their initial values.
+		/// \param globals Global shader code, e.g. functions.
+		///
+		void addPass(const std::string& name, const std::string& shader, float resolutionScale = 1.0f,
+			const shader::Constants& constants = {}, const std::string& globals = "");
+
+		void setEnabled(const std::string& name, bool enabled);
+
+		///
+		/// \brief setConstants sets uniform values of the pass. Names must be declared in constants of addPass.
+		///
+		void setConstants(const std::string& name, const shader::Constants& constants);
+
+		void setFormat(RenderTargetPool::Format format);
+
+		///
+		/// \brief apply runs enabled passes on the input texture and returns output of the last pass, or input if
+		/// no pass is enabled. Returned texture is valid until next apply. Blending is disabled during the passes
+		/// and blending and viewport are restored after them.
+		///
+		const texture::Texture& apply(const texture::Texture& input);
+
+		size_t getNumPasses() const;
+
+	private:
+		struct Pass {
+			std::string name;
+			shader::Shader::Ref shader;
+			shader::Constants constants;
+			float resolutionScale;
+			bool enabled;
+		};
+
+		Pass& find(const std::string& name);
+
+		std::shared_ptr<RenderTargetPool>	m_pool;
+		std::vector<Pass>					m_passes;
+		std::shared_ptr<mesh::Mesh>			m_quad;
+		RenderTargetPool::Target*			m_output;	// Output of the last apply, kept until next apply
+		RenderTargetPool::Format			m_format;
+
+		// Copy not allowed
+		PostProcessChain(const PostProcessChain&) = delete;
+		PostProcessChain& operator=(const PostProcessChain&) = delete;
+	};
+}
+} // End - hungerland
@@ -0,0 +1,195 @@
+/*=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+ MIT License
+
+ Copyright (c) 2022 Mikko Romppainen (kajakbros@gmail.com)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
+#pragma once
+#include <hungerland/math.h>
+#include <hungerland/sprite_batch.h>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+
+namespace hungerland {
+namespace texture {
+	class Texture;
+}
+namespace map {
+	class Map;
+}
+namespace graphics {
+
+	///
+	/// \brief The hungerland::graphics::CommandList class
+	///
+	/// Records draw commands without touching GL, so a command list can be filled on any thread.
+	/// Each command has a 64 bit sort key made of layer, depth, shader and texture. Commands are
+	/// executed by RenderQueue::flush in key order: layers ascending, then depth ascending (back to front),
+	/// then grouped by shader and texture. Commands with equal keys keep their recording order.
+	///
+	/// Textures, shaders and maps referenced by commands must be alive until the queue is flushed.
+	///
+	/// @ingroup hungerland::graphics
+	///
+	class CommandList {
+	public:
+		typedef std::function<void()> ExecuteFunc;
+
+		///
+		/// \brief makeKey returns sort key of a command.
+		/// \param layer Most significant part of the key.
+		/// \param depth Order inside layer. Quantized to 16 bits, so nearly equal depths may compare equal.
+		/// \param shaderId Program id, only low 16 bits are used. Used for grouping only.
+		/// \param textureId Texture id, only low 24 bits are used. Used for grouping only.
+		///
+		static uint64_t makeKey(uint8_t layer, float depth, unsigned shaderId, unsigned textureId);
+
+		///
+		/// \brief drawSprite records a sprite. See SpriteBatch::draw.
+		/// \param layer
+		/// \param depth
+		/// \param projection
+		/// \param texture
+		/// \param transform
+		/// \param uvRect
+		/// \param tint
+		/// \param shader Shader created with shaders::createSpriteBatch, or 0 for the default sprite shader.
+		///
+		void drawSprite(uint8_t layer, float depth, const glm::mat4& projection, const texture::Texture& texture, const glm::mat4& transform,
+						const glm::vec4& uvRect = glm::vec4(0,0,1,1), const glm::vec4& tint = glm::vec4(1), const shader::Shader* shader = 0);
+
+		///
+		/// \brief drawMap records all layers of a map. See map::draw.
+		/// \param layer
+		/// \param depth
+		/// \param map
+		/// \param projection
+		/// \param cameraDelta
+		///
+		void drawMap(uint8_t layer, float depth, const map::Map& map, const glm::mat4& projection, const glm::vec2& cameraDelta);
+
+		///
+		/// \brief execute records a function, which is called on the render thread at its place in the sorted order.
+		/// Use for drawing, which has no command of its own.
+		/// \param layer
+		/// \param depth
+		/// \param func
+		///
+		void execute(uint8_t layer, float depth, ExecuteFunc func);
+
+		///
+		/// \brief append appends all commands of other list after commands of this list.
+		/// \param other
+		///
+		void append(const CommandList& other);
+
+		void clear();
+
+		size_t size() const;
+
+		bool empty() const;
+
+	protected:
+		enum class Type : uint32_t {
+			SPRITE,
+			MAP,
+			EXECUTE,
+		};
+
+		struct Command {
+			uint64_t key;
+			Type type;
+			uint32_t index;		// Index to payload array of the type
+		};
+
+		struct SpriteCommand {
+			const shader::Shader* shader;
+			unsigned textureId;
+			uint32_t projection;	// Index to m_projections
+			SpriteBatch::Instance instance;
+		};
+
+		struct MapCommand {
+			const map::Map* map;
+			glm::mat4 projection;
+			glm::vec2 cameraDelta;
+		};
+
+		uint32_t addProjection(const glm::mat4& projection);
+
+		std::vector<Command>		m_commands;
+		std::vector<SpriteCommand>	m_sprites;
+		std::vector<MapCommand>		m_maps;
+		std::vector<ExecuteFunc>	m_executes;
+		std::vector<glm::mat4>		m_projections;	// Projections of sprites. Consecutive equal projections are stored once.
+	};
+
+	///
+	/// \brief The hungerland::graphics::RenderQueue class
+	///
+	/// Command list of a frame, which is sorted and submitted to GL in one pass by flush. Commands can be
+	/// recorded directly to the queue on the render thread. Other threads record to their own CommandList
+	/// and hand it over with submit. Window flushes the queue of the screen after the user render function.
+	///
+	/// Sprites are sorted with a radix sort and drawn through a SpriteBatch: each run of consecutive sprites
+	/// with same shader and texture becomes one instanced draw call.
+	///
+	/// @ingroup hungerland::graphics
+	///
+	class RenderQueue : public CommandList {
+	public:
+		explicit RenderQueue(SpriteBatch& spriteBatch);
+
+		///
+		/// \brief submit moves commands of list to the queue. Thread safe, but all submits of a frame must
+		/// complete before flush. Submitted commands are ordered after commands recorded directly to the queue,
+		/// if their keys are equal.
+		/// \param list
+		///
+		void submit(CommandList&& list);
+
+		///
+		/// \brief flush sorts all commands and executes them. Must be called on the render thread.
+		/// The queue is empty afterwards.
+		///
+		void flush();
+
+		///
+		/// \brief getNumFlushedCommands returns number of commands executed by the last flush.
+		///
+		size_t getNumFlushedCommands() const;
+
+	private:
+		void sortCommands();
+
+		SpriteBatch&			m_spriteBatch;
+		std::mutex				m_submitMutex;
+		CommandList				m_submitted;
+		std::vector<Command>	m_sortBuffer;
+		size_t					m_numFlushedCommands;
+
+		// Copy not allowed
+		RenderQueue(const RenderQueue&) = delete;
+		RenderQueue& operator=(const RenderQueue&) = delete;
+	};
+}
+}
@@ -24,6 +24,8 @@
 #pragma once
 #include <hungerland/shader.h>
 #include <hungerland/math.h>
+#include <hungerland/sprite_batch.h>
+#include <hungerland/render_queue.h>
 
 namespace hungerland {
 namespace mesh {
@@ -83,6 +85,23 @@ namespace screen {
 		///
 		void drawSprite(const glm::mat4& transform, const texture::Texture& texture, const std::vector<shader::Constant>& constants={}, const std::string& surfaceShader="", const std::string& globals="");
 
+		///
+		/// \brief getSpriteBatch returns sprite batch of the screen. Use it instead of drawSprite for many sprites:
+		/// sprites between begin and end are drawn with one instanced draw call per texture.
+		///
+		graphics::SpriteBatch& getSpriteBatch();
+
+		///
+		/// \brief getRenderQueue returns render queue of the screen. Commands recorded to the queue are sorted
+		/// and drawn after the render function of the window returns.
+		///
+		graphics::RenderQueue& getRenderQueue();
+
+		///
+		/// \brief getProjection returns projection set by setScreen.
+		///
+		const glm::mat4& getProjection() const;
+
 		///
 		/// \brief drawScreenSizeQuad
 		/// \param texture
@@ -101,6 +120,8 @@ namespace screen {
 		std::shared_ptr<shader::Shader>         m_ssqShader;
 		std::shared_ptr<mesh::Mesh>				m_ssq;
 		std::shared_ptr<mesh::Mesh>				m_sprite;
+		std::unique_ptr<graphics::SpriteBatch>	m_spriteBatch;
+		std::unique_ptr<graphics::RenderQueue>	m_renderQueue;
 
 	private:
 		// Copy not allowed
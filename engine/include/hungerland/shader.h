@@ -23,6 +23,8 @@
 =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
 #pragma once
 #include <hungerland/types.h>
+#include <cstdint>
+#include <unordered_map>
 
 
 namespace hungerland {
@@ -36,6 +38,23 @@ namespace shader {
 
 	std::string to_string(const Constants& inputConstants);
 
+	///
+	/// \brief Binding points of the std140 uniform blocks shared by engine shaders (see graphics::UniformBuffer).
+	///
+	enum UniformBlockBinding {
+		FRAME_DATA_BINDING = 0,	// FrameData: projection and camera, set once per pass
+		LAYER_DATA_BINDING = 1,	// LayerData: offset, parallax, clipping and opacity of a map layer
+	};
+
+	///
+	/// \brief Active uniform of a linked program.
+	///
+	struct Uniform {
+		int location = -1;
+		unsigned type = 0;	// GL type, for example GL_FLOAT_VEC2
+		int size = 0;		// Number of array elements
+	};
+
 	///
 	/// \brief The ShaderPass class
 	///
@@ -52,7 +71,23 @@ namespace shader {
 		void setUniform(const std::string& name, float x, float y, float z, float w);
 		void setUniformm(const std::string& name, const float* m, bool transposed=false);
 		void setUniform(const std::string& name, int value);
+		void setUniformArray(const std::string& name, const int* values, size_t count);
+		void setUniformArray2(const std::string& name, const float* values, size_t count);
+
+		///
+		/// Setters of uniforms resolved once with Shader::findUniform. Handle must belong to the shader of the pass.
+		/// Null handles are ignored like unknown names, so handles of optional uniforms can be used as such.
+		///
+		void setUniform(const Uniform* uniform, float v);
+		void setUniform(const Uniform* uniform, float x, float y);
+		void setUniform(const Uniform* uniform, float x, float y, float z);
+		void setUniform(const Uniform* uniform, float x, float y, float z, float w);
+		void setUniformm(const Uniform* uniform, const float* m, bool transposed=false);
+		void setUniform(const Uniform* uniform, int value);
+		void setUniformArray(const Uniform* uniform, const int* values, size_t count);
+		void setUniformArray2(const Uniform* uniform, const float* values, size_t count);
 	private:
+		const Uniform* find(const std::string& name, unsigned type) const;
 		const Shader& m_shader;
 	};
 
@@ -65,21 +100,64 @@ namespace shader {
 	class Shader {
 	public:
 		typedef std::shared_ptr<Shader> Ref;
-		Shader(const std::string& vertexShaderString, const std::string& fragmentShaderString);
+
+		///
+		/// Called with the program after shaders are attached and before linking, e.g. to set program parameters.
+		///
+		typedef std::function<void(unsigned program)> PreLinkFunc;
+
+		Shader(const std::string& vertexShaderString, const std::string& fragmentShaderString, PreLinkFunc preLink = 0);
+
+		///
+		/// \brief Shader takes ownership of already linked program, for example loaded from program binary.
+		///
+		explicit Shader(unsigned linkedProgram);
 		~Shader();
 
 		void use(RenderFunc render) const;
 
 		unsigned getId() const ;
 
+		///
+		/// \brief findUniform returns active uniform by name without GL calls, or 0 if not found.
+		/// Array uniforms are found with and without "[0]".
+		///
+		const Uniform* findUniform(const std::string& name) const;
+
 	private:
+		void reflect();
+
 		unsigned m_shaderProgram;	// Handle to the shader program
+		std::unordered_map<std::string, Uniform> m_uniforms;	// Active uniforms enumerated at link time
 
 		// Copy not allowed
 		Shader(const Shader&) = delete;
 		Shader& operator=(const Shader&) = delete;
 	};
 
+	///
+	/// \brief getCached returns shared shader of the sources. Shaders are cached by hash of the sources, so each
+	/// unique program is compiled only once. If cache directory is set, linked programs are also stored as program
+	/// binaries and loaded from there on next launches, when the driver supports program binaries. Source lengths
+	/// and a second hash are checked on lookup, so colliding sources or stale binaries are compiled from source.
+	///
+	Shader::Ref getCached(const std::string& vertexShaderString, const std::string& fragmentShaderString);
+
+	///
+	/// \brief setCacheDirectory sets directory of program binaries. Empty directory disables the disk cache.
+	///
+	void setCacheDirectory(const std::string& directory);
+
+	///
+	/// \brief clearCache releases cached shaders. Must be called before the GL context is destroyed.
+	///
+	void clearCache();
+
+	///
+	/// \brief hashSource returns 64 bit FNV-1a hash of vertex and fragment shader sources.
+	///
+	uint64_t hashSource(const std::string& vertexShaderString, const std::string& fragmentShaderString);
+
 	static inline Shader::Ref standardShader(const std::vector<shader::Constant>& constants, const std::string& surfaceShader, const std::string& globals) {
 		return 0;
 	}
@@ -0,0 +1,133 @@
+/*=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+ MIT License
+
+ Copyright (c) 2022 Mikko Romppainen (kajakbros@gmail.com)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
+#pragma once
+#include <hungerland/math.h>
+#include <hungerland/shader.h>
+#include <vector>
+#include <memory>
+
+namespace hungerland {
+namespace texture {
+	class Texture;
+}
+namespace graphics {
+	class UniformBuffer;
+	class StreamBuffer;
+
+	///
+	/// \brief The hungerland::graphics::SpriteBatch class
+	///
+	/// Collects sprites between begin and end into an instance buffer and draws them with one instanced
+	/// draw call per texture and shader. Sprite shader programs are compiled once, see shaders::createSpriteBatch.
+	///
+	/// @ingroup hungerland::graphics
+	///
+	class SpriteBatch {
+	public:
+		enum class SortMode {
+			SUBMISSION,	// Keep submission order, merge only consecutive sprites with same texture and shader
+			TEXTURE,	// Group all sprites by texture and shader. Order of sprites with different textures is not kept.
+		};
+
+		///
+		/// \brief Per sprite instance data: transform columns 0,1 and 3 of 2D model matrix, uv rect and tint.
+		///
+		struct Instance {
+			glm::vec4 column0;
+			glm::vec4 column1;
+			glm::vec4 column3;
+			glm::vec4 uvRect;	// u0, v0, u1, v1
+			glm::vec4 tint;
+		};
+
+		explicit SpriteBatch(size_t initialCapacity = 1024);
+		~SpriteBatch();
+
+		///
+		/// \brief begin starts a new batch.
+		/// \param projection Projection used for all sprites of the batch.
+		/// \param sortMode
+		///
+		void begin(const glm::mat4& projection, SortMode sortMode = SortMode::TEXTURE);
+
+		///
+		/// \brief draw adds sprite to the batch. Sprite is an unit quad centered at origin transformed by transform.
+		/// Texture must be alive until end.
+		/// \param texture
+		/// \param transform
+		/// \param uvRect Texture rectangle u0, v0, u1, v1.
+		/// \param tint Color multiplied with the texture color.
+		/// \param shader Shader created with shaders::createSpriteBatch, or 0 for the default sprite shader.
+		///
+		void draw(const texture::Texture& texture, const glm::mat4& transform, const glm::vec4& uvRect = glm::vec4(0,0,1,1),
+				  const glm::vec4& tint = glm::vec4(1), const shader::Shader* shader = 0);
+
+		///
+		/// \brief draw adds prepared sprite instance to the batch.
+		/// \param textureId
+		/// \param instance
+		/// \param shader Shader created with shaders::createSpriteBatch, or 0 for the default sprite shader.
+		///
+		void draw(unsigned textureId, const Instance& instance, const shader::Shader* shader = 0);
+
+		///
+		/// \brief end uploads instances and draws all sprites of the batch.
+		///
+		void end();
+
+		///
+		/// \brief getNumDrawCalls returns number of instanced draw calls of the last batch.
+		///
+		size_t getNumDrawCalls() const;
+
+	private:
+		struct Sprite {
+			const shader::Shader* shader;
+			unsigned textureId;
+			Instance instance;
+		};
+
+		void setInstanceOffset(size_t base);
+		const shader::Uniform* getTextureUniform(const shader::Shader& shader);
+
+		shader::Shader::Ref			m_defaultShader;
+		std::unique_ptr<UniformBuffer>	m_uniformBuffer;
+		std::unique_ptr<StreamBuffer>	m_instanceBuffer;	// Instances of all batches of a frame
+		glm::mat4					m_projection;
+		SortMode					m_sortMode;
+		std::vector<Sprite>			m_sprites;
+		std::vector<size_t>			m_order;
+		std::vector<Instance>		m_instances;
+		std::vector< std::pair<const shader::Shader*, const shader::Uniform*> > m_textureUniforms;	// Handles resolved during the batch
+		size_t						m_numDrawCalls;
+		bool						m_begun;
+		unsigned					m_vao;
+		unsigned					m_quadVbo;
+
+		// Copy not allowed
+		SpriteBatch(const SpriteBatch&) = delete;
+		SpriteBatch& operator=(const SpriteBatch&) = delete;
+	};
+}
+}
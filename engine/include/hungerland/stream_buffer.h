@@ -0,0 +1,115 @@
+/*=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+ MIT License
+
+ Copyright (c) 2022 Mikko Romppainen (kajakbros@gmail.com)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
+#pragma once
+#include <deque>
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+namespace hungerland {
+namespace graphics {
+
+	///
+	/// \brief The hungerland::graphics::StreamBuffer class
+	///
+	/// Ring of vertex buffer memory for geometry, which changes every frame. Writes are appended after the
+	/// previous write, so the buffer storage is allocated only once. GPU progress is tracked with one fence per frame
+	/// and a write waits only if it would overwrite data of a frame the GPU has not finished yet.
+	///
+	/// Storage is mapped persistently, when GL 4.4 or ARB_buffer_storage is available. Otherwise each write maps
+	/// its range with glMapBufferRange without synchronization, which is safe because of the fences.
+	/// If one frame writes more than the capacity, the storage is orphaned or, when mapped persistently, the writer
+	/// waits for the GPU. Data of a write must be drawn before a later write of the same frame wraps over it.
+	///
+	/// Vertex attribute pointers must be set with the buffer bound to GL_ARRAY_BUFFER (see bind) and offset
+	/// returned by the write.
+	///
+	/// @ingroup hungerland::graphics
+	///
+	class StreamBuffer {
+	public:
+		explicit StreamBuffer(size_t capacity = 4*1024*1024);
+		~StreamBuffer();
+
+		///
+		/// \brief map reserves size bytes and returns pointer for writing them. Call unmap before drawing.
+		/// \param size
+		/// \param offset Offset of the reserved range in the buffer.
+		/// \param alignment Alignment of the offset, for example size of the vertex.
+		///
+		void* map(size_t size, size_t& offset, size_t alignment = 16);
+
+		///
+		/// \brief unmap ends writing of the range reserved by map.
+		///
+		void unmap();
+
+		///
+		/// \brief write copies data to the buffer.
+		/// \return Offset of the data in the buffer.
+		///
+		size_t write(const void* data, size_t size, size_t alignment = 16);
+
+		template<typename T>
+		size_t write(const std::vector<T>& data) {
+			return write(data.data(), data.size() * sizeof(T), sizeof(T));
+		}
+
+		///
+		/// \brief bind binds the buffer to GL_ARRAY_BUFFER.
+		///
+		void bind() const;
+
+		unsigned getId() const;
+		size_t getCapacity() const;
+		bool isPersistent() const;
+
+	private:
+		struct Fence {
+			void*	sync;	// GLsync
+			size_t	begin;	// Range written in the frame of the fence. end < begin if the range wraps.
+			size_t	end;
+		};
+
+		size_t reserve(size_t size, size_t alignment);
+		void beginFrame();
+		void waitOldest();
+
+		unsigned			m_bufferId;
+		size_t				m_capacity;
+		size_t				m_head;			// Next free byte
+		size_t				m_frameBegin;	// Head at first write of the current frame
+		size_t				m_frameNumber;	// glstate frame of the current frame
+		bool				m_frameWritten;
+		bool				m_frameWrapped;	// Head wrapped to the start during the current frame
+		uint8_t*			m_persistent;	// Persistently mapped storage or 0
+		bool				m_mapped;
+		std::deque<Fence>	m_fences;		// Oldest first
+
+		// Copy not allowed
+		StreamBuffer(const StreamBuffer&) = delete;
+		StreamBuffer& operator=(const StreamBuffer&) = delete;
+	};
+}
+}
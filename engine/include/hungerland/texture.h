@@ -39,30 +39,84 @@ namespace texture {
         Texture(/*unsigned width, unsigned height, unsigned nrChannels*/);
         Texture(unsigned width, unsigned height, unsigned nrChannels, const uint8_t* data);
         Texture(unsigned width, unsigned height, unsigned nrChannels, const float* data);
+        Texture(unsigned width, unsigned height, unsigned nrChannels, const uint32_t* data);
         Texture(unsigned width, unsigned height, bool isDepthTexture);
         ~Texture();
 
         void setData(unsigned width, unsigned height, unsigned nrChannels, const float* data);
         void setData(unsigned width, unsigned height, unsigned nrChannels, const uint8_t* data);
+        void setData(unsigned width, unsigned height, unsigned nrChannels, const uint32_t* data);
+
+        ///
+        /// \brief setSubData updates rectangle of byte, float or unsigned integer texture without reallocating it.
+        ///
+        void setSubData(unsigned x, unsigned y, unsigned width, unsigned height, unsigned nrChannels, const uint8_t* data);
+        void setSubData(unsigned x, unsigned y, unsigned width, unsigned height, unsigned nrChannels, const float* data);
+        void setSubData(unsigned x, unsigned y, unsigned width, unsigned height, unsigned nrChannels, const uint32_t* data);
         void setRepeat(bool repeat);
         void setFiltering(bool filter);
 
         void bind(unsigned textureIndex);
 
+        ///
+        /// \brief swap exchanges GL textures of this and other, for example to replace a placeholder in place.
+        ///
+        void swap(Texture& other);
+
         unsigned getId() const;
         unsigned getWidth() const;
         unsigned getHeight() const;
 
+        ///
+        /// \brief getSizeInBytes returns estimated GPU memory of the texture from its size and format.
+        ///
+        size_t getSizeInBytes() const;
+
     private:
         unsigned	m_textureId;	// Texture id
         unsigned	m_width;
         unsigned	m_height;
         unsigned	m_nrChannels;
+        unsigned	m_bytesPerChannel;
 
         // Copy not allowed
         //Texture() = delete;
         Texture(const Texture&) = delete;
         Texture& operator=(const Texture&) = delete;
     };
+
+    ///
+    /// \brief The TextureArray class is a 2D texture array of 8 bit RGBA layers of same size.
+    ///
+    /// @ingroup hungerland::texture
+    ///
+    class TextureArray {
+    public:
+        typedef std::shared_ptr<TextureArray> Ref;
+        TextureArray(unsigned width, unsigned height, unsigned numLayers);
+        ~TextureArray();
+
+        ///
+        /// \brief setLayerData sets top left width x height pixels of the given layer.
+        ///
+        void setLayerData(unsigned layer, unsigned width, unsigned height, const uint8_t* rgba);
+
+        void bind(unsigned textureIndex);
+
+        unsigned getId() const;
+        unsigned getWidth() const;
+        unsigned getHeight() const;
+        unsigned getNumLayers() const;
+
+    private:
+        unsigned	m_textureId;	// Texture id
+        unsigned	m_width;
+        unsigned	m_height;
+        unsigned	m_numLayers;
+
+        // Copy not allowed
+        TextureArray(const TextureArray&) = delete;
+        TextureArray& operator=(const TextureArray&) = delete;
+    };
 }
 }
@@ -0,0 +1,109 @@
+/*=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+ MIT License
+
+ Copyright (c) 2022 Mikko Romppainen (kajakbros@gmail.com)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
+#pragma once
+#include <hungerland/math.h>
+#include <hungerland/texture.h>
+#include <memory>
+#include <vector>
+#include <stdint.h>
+
+namespace hungerland {
+namespace texture {
+
+	///
+	/// \brief The hungerland::texture::AtlasRegion is a handle to an image packed into a TextureAtlas.
+	///
+	/// @ingroup hungerland::texture
+	///
+	struct AtlasRegion {
+		Texture::Ref texture;					// Atlas page, which contains the image
+		unsigned x = 0;							// Pixel rectangle of the image inside the page, without padding
+		unsigned y = 0;
+		unsigned width = 0;
+		unsigned height = 0;
+		glm::vec4 uvRect = glm::vec4(0,0,1,1);	// u0, v0, u1, v1 of the image, see graphics::SpriteBatch::draw
+	};
+
+	///
+	/// \brief The hungerland::texture::TextureAtlas class packs images into a few large 8 bit RGBA textures.
+	///
+	/// Images are packed at runtime with the skyline bottom-left heuristic, in the order they are added.
+	/// Each image is surrounded by padding, which is filled by repeating the edge pixels of the image (bleed),
+	/// so that filtering does not sample neighbouring images. Sprites of one atlas page share a texture,
+	/// so they can be drawn with one draw call. A new page is created, when an image does not fit to
+	/// any existing page. Images larger than a page get a texture of their own.
+	///
+	/// @ingroup hungerland::texture
+	///
+	class TextureAtlas {
+	public:
+		///
+		/// \brief TextureAtlas
+		/// \param pageSize Width and height of the atlas page textures.
+		/// \param padding Pixels of bleed around each image.
+		///
+		explicit TextureAtlas(unsigned pageSize = 2048, unsigned padding = 2);
+		~TextureAtlas();
+
+		///
+		/// \brief add packs an image to the atlas and uploads it to the page texture.
+		/// \param width
+		/// \param height
+		/// \param nrChannels 1 to 4. Grey images are expanded to RGB.
+		/// \param data Pixel rows of the image.
+		/// \return Region of the image.
+		///
+		AtlasRegion add(unsigned width, unsigned height, unsigned nrChannels, const uint8_t* data);
+
+		size_t getNumPages() const;
+
+		const Texture::Ref& getPage(size_t index) const;
+
+	private:
+		struct SkylineNode {
+			unsigned x;
+			unsigned y;
+			unsigned width;
+		};
+
+		struct Page {
+			Texture::Ref texture;
+			std::vector<SkylineNode> skyline;	// Top edge of used area from left to right
+		};
+
+		bool findPosition(const Page& page, unsigned width, unsigned height, size_t& nodeIndex, unsigned& y) const;
+		void addSkylineLevel(Page& page, size_t nodeIndex, unsigned y, unsigned width, unsigned height);
+		Page& createPage();
+
+		unsigned			m_pageSize;
+		unsigned			m_padding;
+		std::vector<Page>	m_pages;
+		std::vector<uint8_t>	m_padded;	// Padded RGBA image of the last add
+
+		// Copy not allowed
+		TextureAtlas(const TextureAtlas&) = delete;
+		TextureAtlas& operator=(const TextureAtlas&) = delete;
+	};
+}
+}
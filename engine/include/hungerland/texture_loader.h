@@ -0,0 +1,140 @@
+/*=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+ MIT License
+
+ Copyright (c) 2022 Mikko Romppainen (kajakbros@gmail.com)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
+#pragma once
+#include <hungerland/texture.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+namespace hungerland {
+namespace texture {
+
+	///
+	/// \brief The hungerland::texture::DecodedImage struct is an 8 bit RGBA image decoded by a worker thread.
+	///
+	struct DecodedImage {
+		unsigned width = 0;
+		unsigned height = 0;
+		std::vector<uint8_t> pixels;	// width * height * 4 bytes, rows from the first row of the image
+	};
+
+	///
+	/// \brief The hungerland::texture::TextureLoader class loads textures without blocking the render thread.
+	///
+	/// load returns a texture handle immediately. Until the image is resident, the handle is a 1x1 placeholder
+	/// texture. Images are decoded by a pool of worker threads. update uploads decoded images on the render thread
+	/// through a pixel buffer object, at most uploadBytesPerFrame bytes per call, so large images are spread
+	/// over several frames. When all rows of an image are uploaded, the uploaded texture is swapped into the
+	/// handle, so every holder of the handle draws the real texture from then on.
+	///
+	/// @ingroup hungerland::texture
+	///
+	class TextureLoader {
+	public:
+		///
+		/// Decodes image file to RGBA. Called from worker threads, so it must not use GL.
+		///
+		typedef std::function<bool(const std::string&, DecodedImage&)> DecodeFunc;
+
+		///
+		/// \brief TextureLoader
+		/// \param decode
+		/// \param numWorkers Number of decoding threads.
+		/// \param uploadBytesPerFrame Upload budget of one update.
+		///
+		TextureLoader(DecodeFunc decode, size_t numWorkers = 2, size_t uploadBytesPerFrame = 4*1024*1024);
+		~TextureLoader();
+
+		///
+		/// \brief load starts loading of an image file. Files are loaded only once.
+		/// \param filename
+		/// \return Texture handle, which is a placeholder until the image is resident.
+		///
+		Texture::Ref load(const std::string& filename);
+
+		///
+		/// \brief isResident returns true if the image of the file has been uploaded.
+		///
+		bool isResident(const std::string& filename) const;
+
+		///
+		/// \brief update uploads decoded images within the upload budget. Call once per frame on the render thread.
+		///
+		/// Files, which failed to decode, are reported as warnings and keep the placeholder texture.
+		///
+		void update();
+
+		///
+		/// \brief getNumPending returns number of files, which are not resident yet. Failed files are not counted.
+		///
+		size_t getNumPending() const;
+
+	private:
+		enum class State {
+			DECODING,
+			UPLOADING,
+			RESIDENT,
+			FAILED,
+		};
+
+		struct Entry {
+			Texture::Ref handle;
+			State state = State::DECODING;
+		};
+
+		struct Upload {
+			std::string filename;
+			DecodedImage image;
+			std::unique_ptr<Texture> texture;	// Uploaded rows, swapped into the handle when complete
+			unsigned rowsUploaded = 0;
+		};
+
+		void work();
+		bool uploadRows(Upload& upload, size_t& budget);
+
+		DecodeFunc					m_decode;
+		size_t						m_uploadBytesPerFrame;
+		std::map<std::string, Entry>	m_entries;		// Render thread only
+		std::deque<Upload>			m_uploads;		// Decoded images waiting for upload, render thread only
+		unsigned					m_pbo;
+
+		mutable std::mutex			m_mutex;		// Guards the queues below
+		std::condition_variable		m_workAvailable;
+		std::deque<std::string>		m_decodeQueue;
+		std::deque<std::pair<std::string, std::unique_ptr<DecodedImage> > >	m_decoded;	// 0 image if decoding failed
+		bool						m_stopping;
+		std::vector<std::thread>	m_workers;
+
+		// Copy not allowed
+		TextureLoader(const TextureLoader&) = delete;
+		TextureLoader& operator=(const TextureLoader&) = delete;
+	};
+}
+}
@@ -0,0 +1,124 @@
+/*=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+ MIT License
+
+ Copyright (c) 2022 Mikko Romppainen (kajakbros@gmail.com)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
+#pragma once
+#include <hungerland/texture.h>
+#include <functional>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+namespace hungerland {
+namespace texture {
+
+	///
+	/// \brief The hungerland::texture::TextureManager class caches textures by file name within a memory budget.
+	///
+	/// Each texture is accounted with its estimated GPU size (Texture::getSizeInBytes). When the resident bytes
+	/// exceed the budget, least recently used textures, which are not referenced outside of the manager, are
+	/// released. Referenced textures are never released, so resident bytes may stay above the budget while they
+	/// are in use.
+	///
+	/// @ingroup hungerland::texture
+	///
+	class TextureManager {
+	public:
+		///
+		/// Loads texture of the file, or returns 0 if loading fails.
+		///
+		typedef std::function<Texture::Ref(const std::string&)> LoadFunc;
+
+		///
+		/// \brief Residency counters.
+		///
+		struct Stats {
+			size_t numTextures = 0;		// Resident textures
+			size_t residentBytes = 0;
+			size_t budgetBytes = 0;
+			size_t hits = 0;			// get calls, which found a resident texture
+			size_t misses = 0;			// get calls, which loaded the texture
+			size_t numEvicted = 0;
+			size_t evictedBytes = 0;
+		};
+
+		///
+		/// \brief TextureManager
+		/// \param load
+		/// \param budgetBytes
+		///
+		explicit TextureManager(LoadFunc load, size_t budgetBytes = 512*1024*1024);
+		~TextureManager();
+
+		///
+		/// \brief get returns texture of the file and marks it as most recently used. Loads the texture if it is
+		/// not resident and evicts other textures if the budget is exceeded.
+		/// \param filename
+		/// \return Texture, or 0 if loading fails.
+		///
+		Texture::Ref get(const std::string& filename);
+
+		///
+		/// \brief setBudget sets memory budget and evicts textures to fit to it.
+		///
+		void setBudget(size_t budgetBytes);
+
+		///
+		/// \brief evict releases unreferenced textures from least recently used until resident bytes fit
+		/// to maxBytes.
+		/// \param maxBytes
+		/// \return Number of bytes released.
+		///
+		size_t evict(size_t maxBytes);
+
+		///
+		/// \brief evict releases unreferenced textures until resident bytes fit to the budget.
+		///
+		size_t evict();
+
+		///
+		/// \brief clear releases all textures of the manager. Textures referenced elsewhere stay alive until
+		/// they are released there.
+		///
+		void clear();
+
+		const Stats& getStats() const;
+
+	private:
+		struct Entry {
+			std::string filename;
+			Texture::Ref texture;
+			size_t bytes;
+		};
+		typedef std::list<Entry> LruList;	// Most recently used first
+
+		LoadFunc		m_load;
+		LruList			m_lru;
+		std::unordered_map<std::string, LruList::iterator>	m_entries;
+		Stats			m_stats;
+
+		// Copy not allowed
+		TextureManager(const TextureManager&) = delete;
+		TextureManager& operator=(const TextureManager&) = delete;
+	};
+}
+}
@@ -0,0 +1,89 @@
+/*=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+ MIT License
+
+ Copyright (c) 2022 Mikko Romppainen (kajakbros@gmail.com)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
+#pragma once
+#include <hungerland/math.h>
+#include <memory>
+
+namespace hungerland {
+namespace graphics {
+
+	///
+	/// \brief std140 layout of the FrameData uniform block (see shader::FRAME_DATA_BINDING).
+	///
+	struct FrameData {
+		glm::mat4 P;
+		glm::vec4 camera;	// Camera position (xy) used for parallax
+	};
+	static_assert(sizeof(FrameData) == 80, "FrameData must match std140 layout");
+
+	///
+	/// \brief std140 layout of the LayerData uniform block (see shader::LAYER_DATA_BINDING).
+	///
+	struct LayerData {
+		glm::vec2 offset;
+		glm::vec2 parallax;
+		glm::vec2 clipMin;			// Visible rectangle of the layer quad
+		glm::vec2 clipMax;
+		glm::vec2 texCoordScale;	// Texture coordinates per position unit
+		float opacity;
+		float padding;
+	};
+	static_assert(sizeof(LayerData) == 48, "LayerData must match std140 layout");
+
+	///
+	/// \brief The hungerland::graphics::UniformBuffer class
+	///
+	/// Streaming uniform buffer. Each push appends data to the next aligned offset and binds that range to an
+	/// uniform block binding point, so draws of a frame do not overwrite data of earlier draws. When the buffer is
+	/// full, it is orphaned and filled again from the start.
+	///
+	/// @ingroup hungerland::graphics
+	///
+	class UniformBuffer {
+	public:
+		explicit UniformBuffer(size_t capacity = 64*1024);
+		~UniformBuffer();
+
+		///
+		/// \brief push uploads data and binds it to the binding point.
+		///
+		void push(unsigned binding, const void* data, size_t size);
+
+		template<typename T>
+		void push(unsigned binding, const T& data) {
+			push(binding, &data, sizeof(T));
+		}
+
+	private:
+		unsigned	m_bufferId;
+		size_t		m_capacity;
+		size_t		m_offset;
+		size_t		m_alignment;	// GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+
+		// Copy not allowed
+		UniformBuffer(const UniformBuffer&) = delete;
+		UniformBuffer& operator=(const UniformBuffer&) = delete;
+	};
+}
+}
@@ -23,6 +23,10 @@
 =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
 #pragma once
 #include <hungerland/screen.h>
+#include <hungerland/texture_atlas.h>
+#include <hungerland/texture_loader.h>
+#include <hungerland/texture_manager.h>
+#include <hungerland/frame_capture.h>
 #include <map>
 
 struct GLFWwindow;
@@ -103,8 +107,13 @@ namespace window {
         /// \brief Window
         /// \param size
         /// \param title
+        /// \param resizable
+        /// \param headless Creates hidden window without vsync and renders to an offscreen framebuffer of the
+        /// window size, for servers, automated benchmarks and thumbnails. If the native context can not be created,
+        /// OSMesa and EGL contexts are tried. GLFW still needs a display connection, so on machines without
+        /// a display run under a virtual X server, for example xvfb-run with Mesa software rendering.
         ///
-        explicit Window(size2d_t size, const std::string& title, bool resizable = false);
+        explicit Window(size2d_t size, const std::string& title, bool resizable = false, bool headless = false);
         ~Window();
 
         ///
@@ -134,11 +143,34 @@ namespace window {
 
 
         ///
-        /// \brief screenshot
+        /// \brief screenshot saves the next rendered frame as png. The frame is read back and encoded
+        /// asynchronously, so the file is written a few frames later.
         /// \param filename
         ///
         void screenshot(const std::string filename);
 
+        ///
+        /// \brief startRecording streams all rendered frames as raw RGBA to the file, see graphics::FrameCapture.
+        /// \param filename
+        /// \return false if the file can not be opened.
+        ///
+        bool startRecording(const std::string& filename);
+
+        ///
+        /// \brief stopRecording finishes and closes the recording.
+        ///
+        void stopRecording();
+
+        bool isRecording() const;
+
+        bool isHeadless() const;
+
+        ///
+        /// \brief getOffscreenTexture returns color texture, which a headless window renders to, or 0 if the
+        /// window is not headless.
+        ///
+        const texture::Texture* getOffscreenTexture() const;
+
         ///
         /// \brief playSound
         /// \param fileName
@@ -146,19 +178,52 @@ namespace window {
         void playSound(const std::string& fileName);
 
         ///
-        /// \brief loadTexture
+        /// \brief loadTexture loads texture or returns the resident texture of the file.
+        /// Unused textures are released, when the texture budget of the manager is exceeded.
         /// \param filename
         /// \return
         ///
         std::shared_ptr<texture::Texture> loadTexture(const std::string& filename);
 
+        ///
+        /// \brief getTextureManager returns manager of textures loaded with loadTexture, for budget and stats.
+        ///
+        texture::TextureManager& getTextureManager();
+
+        ///
+        /// \brief loadAtlasTexture loads an image and packs it to the texture atlas of the window.
+        /// Sprites loaded with it share few atlas textures, so they can be drawn with few draw calls.
+        /// Draw the sprite with the uvRect of the returned region. Atlas pages are not part of the texture
+        /// budget and are kept until resetAtlas, so call it when the loaded images are no longer needed.
+        /// \param filename
+        /// \return Region of the image, or region without texture if loading fails.
+        ///
+        texture::AtlasRegion loadAtlasTexture(const std::string& filename);
+
+        ///
+        /// \brief resetAtlas releases the texture atlas and forgets all regions loaded with loadAtlasTexture, for
+        /// example between levels. Pages stay alive while regions returned earlier still reference them.
+        ///
+        void resetAtlas();
+
+        ///
+        /// \brief loadTextureAsync starts loading a texture on worker threads and returns immediately.
+        /// The returned texture is a transparent placeholder, until the image has been uploaded. Uploads are
+        /// done at the start of render within a per frame byte budget.
+        /// \param filename
+        /// \return
+        ///
+        std::shared_ptr<texture::Texture> loadTextureAsync(const std::string& filename);
+
         const UserInput& getInput() const {
             return m_inputMap;
         }
     private:
-        typedef std::map<std::string, std::shared_ptr<texture::Texture> > TextureMap;
+        typedef std::map<std::string, texture::AtlasRegion> AtlasRegionMap;
         typedef std::unique_ptr<screen::FrameBuffer> Screen;
 
+        graphics::FrameCapture& getFrameCapture();
+
         Window() = delete;
         Window(const Window&) = delete;
         Window& operator=(const Window&) = delete;
@@ -166,10 +231,14 @@ namespace window {
         size2d_t		m_size;
         GLFWwindow*		m_window;
 
-        std::string		m_screenshotFileName;
         UserInput		m_inputMap;
         Screen			m_screen;
-        TextureMap		m_textures;
+        std::unique_ptr<texture::TextureManager>	m_textureManager;
+        std::unique_ptr<texture::TextureAtlas>	m_atlas;
+        AtlasRegionMap	m_atlasRegions;
+        std::unique_ptr<texture::TextureLoader>	m_textureLoader;
+        std::unique_ptr<graphics::FrameCapture>	m_frameCapture;
+        std::unique_ptr<graphics::FrameBuffer>	m_offscreen;	// Render target of headless window
 
     };
 
@@ -0,0 +1,145 @@
+/*=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+ MIT License
+
+ Copyright (c) 2022 Mikko Romppainen (kajakbros@gmail.com)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
+#include <hungerland/broadphase.h>
+#include <algorithm>
+#include <cmath>
+#include <assert.h>
+
+namespace hungerland {
+namespace broadphase {
+
+	SpatialHash::SpatialHash(float cellSize, size_t numBuckets)
+		: m_invCellSize(1.0f / cellSize)
+		, m_bucketStart(numBuckets + 1, 0) {
+		assert(cellSize > 0.0f);
+		assert(numBuckets > 0);
+	}
+
+	void SpatialHash::clear() {
+		m_objects.clear();
+		m_entries.clear();
+		m_sortedEntries.clear();
+		std::fill(m_bucketStart.begin(), m_bucketStart.end(), 0);
+	}
+
+	int2d_t SpatialHash::getCell(const glm::vec2& p) const {
+		return {int(std::floor(p.x * m_invCellSize)), int(std::floor(p.y * m_invCellSize))};
+	}
+
+	size_t SpatialHash::getBucket(int2d_t cell) const {
+		const uint32_t h = (uint32_t(cell.x) * 73856093u) ^ (uint32_t(cell.y) * 19349663u);
+		return h % (m_bucketStart.size() - 1);
+	}
+
+	void SpatialHash::insert(Id id, const glm::vec2& center, const glm::vec2& halfSize) {
+		const auto object = uint32_t(m_objects.size());
+		m_objects.push_back({id, center - halfSize, center + halfSize});
+		const auto c0 = getCell(center - halfSize);
+		const auto c1 = getCell(center + halfSize);
+		for(int y = c0.y; y <= c1.y; ++y) {
+			for(int x = c0.x; x <= c1.x; ++x) {
+				m_entries.push_back({{x, y}, object});
+			}
+		}
+	}
+
+	void SpatialHash::build() {
+		// Counting sort of cell entries by bucket:
+		std::fill(m_bucketStart.begin(), m_bucketStart.end(), 0);
+		for(const auto& e : m_entries) {
+			++m_bucketStart[getBucket(e.cell) + 1];
+		}
+		for(size_t i = 1; i < m_bucketStart.size(); ++i) {
+			m_bucketStart[i] += m_bucketStart[i-1];
+		}
+		m_sortedEntries.resize(m_entries.size());
+		for(const auto& e : m_entries) {
+			auto& dst = m_bucketStart[getBucket(e.cell)];
+			m_sortedEntries[dst++] = e;
+		}
+		// Restore bucket starts, which were advanced while scattering:
+		for(size_t i = m_bucketStart.size() - 1; i > 0; --i) {
+			m_bucketStart[i] = m_bucketStart[i-1];
+		}
+		m_bucketStart[0] = 0;
+	}
+
+	void SpatialHash::query(const glm::vec2& center, const glm::vec2& halfSize, std::vector<Id>& result) const {
+		result.clear();
+		const auto lo = center - halfSize;
+		const auto hi = center + halfSize;
+		const auto c0 = getCell(lo);
+		const auto c1 = getCell(hi);
+		for(int y = c0.y; y <= c1.y; ++y) {
+			for(int x = c0.x; x <= c1.x; ++x) {
+				const auto bucket = getBucket({x, y});
+				for(auto i = m_bucketStart[bucket]; i < m_bucketStart[bucket+1]; ++i) {
+					const auto& e = m_sortedEntries[i];
+					if(e.cell.x != x || e.cell.y != y) {
+						continue; // Hash collision with other cell
+					}
+					const auto& o = m_objects[e.object];
+					if(o.lo.x > hi.x || o.hi.x < lo.x || o.lo.y > hi.y || o.hi.y < lo.y) {
+						continue;
+					}
+					// Report only from the cell containing the min corner of the overlap, so that
+					// objects spanning several queried cells are reported once:
+					const auto first = getCell(glm::max(o.lo, lo));
+					if(first.x == x && first.y == y) {
+						result.push_back(o.id);
+					}
+				}
+			}
+		}
+	}
+
+	void SpatialHash::findPairs(std::vector<Pair>& pairs) const {
+		pairs.clear();
+		for(size_t bucket = 0; bucket + 1 < m_bucketStart.size(); ++bucket) {
+			const auto begin = m_bucketStart[bucket];
+			const auto end = m_bucketStart[bucket+1];
+			for(auto i = begin; i < end; ++i) {
+				const auto& ei = m_sortedEntries[i];
+				const auto& a = m_objects[ei.object];
+				for(auto j = i + 1; j < end; ++j) {
+					const auto& ej = m_sortedEntries[j];
+					if(ej.cell.x != ei.cell.x || ej.cell.y != ei.cell.y || ej.object == ei.object) {
+						continue;
+					}
+					const auto& b = m_objects[ej.object];
+					if(a.lo.x > b.hi.x || a.hi.x < b.lo.x || a.lo.y > b.hi.y || a.hi.y < b.lo.y) {
+						continue;
+					}
+					// Report only from the cell containing the min corner of the overlap:
+					const auto first = getCell(glm::max(a.lo, b.lo));
+					if(first.x == ei.cell.x && first.y == ei.cell.y) {
+						pairs.push_back(a.id < b.id ? Pair{a.id, b.id} : Pair{b.id, a.id});
+					}
+				}
+			}
+		}
+	}
+
+}
+}
@@ -79,19 +79,26 @@ namespace engine {
 		m_audioEngine = new ma_engine;
 		auto result = ma_engine_init(NULL, m_audioEngine);
 		if (result != MA_SUCCESS) {
-			throw std::runtime_error("Failed to initialize audio engine!");
-			return;
+			// Servers and CI machines have no audio device, run without sound
+			util::WARN("Failed to initialize audio engine, sounds are disabled!");
+			delete m_audioEngine;
+			m_audioEngine = 0;
 		}
 	}
 
 	Engine::~Engine() {
-		ma_engine_uninit(m_audioEngine);
-		delete m_audioEngine;
+		if(m_audioEngine != 0) {
+			ma_engine_uninit(m_audioEngine);
+			delete m_audioEngine;
+		}
 		// Terminate glfw
 		glfwTerminate();
 	}
 
 	void Engine::playSound(const std::string& fileName) {
+		if(m_audioEngine == 0) {
+			return;
+		}
 		auto result = ma_engine_play_sound(m_audioEngine, fileName.c_str(), NULL);
 		if (result != MA_SUCCESS) {
 			util::ERR("Failed to play sound from file: \""+fileName+"\"!");
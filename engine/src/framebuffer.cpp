@@ -23,6 +23,7 @@
 =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
 #include <hungerland/framebuffer.h>
 #include <hungerland/texture.h>
+#include <hungerland/gl_state.h>
 #include <assert.h>
 #include <stdexcept>
 #include <glad/gl.h>		// Include glad
@@ -42,27 +43,29 @@ namespace {
 }
 
 
-FrameBuffer::FrameBuffer() {
+FrameBuffer::FrameBuffer()
+	: m_previousFboId(0) {
 	glGenFramebuffers(1, &m_fboId);
 	glGenRenderbuffers(1, &m_rboId);
 }
 
 
 FrameBuffer::~FrameBuffer() {
-	glDeleteFramebuffers(1, &m_fboId);
+	glstate::deleteFramebuffer(m_fboId);
 	glDeleteRenderbuffers(1, &m_rboId);
 }
 
 
 void FrameBuffer::addColorTexture( int index, std::shared_ptr<texture::Texture> tex ) {
 	assert( index >= 0 && index < sizeof(COLOR_ATTACHMENT_LOOKUP)/sizeof(COLOR_ATTACHMENT_LOOKUP[0]) );
-	glBindFramebuffer(GL_FRAMEBUFFER, m_fboId);
+	const auto previousFboId = glstate::getFramebuffer();
+	glstate::bindFramebuffer(m_fboId);
 	//glBindRenderbuffer(GL_RENDERBUFFER, m_rboId);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, COLOR_ATTACHMENT_LOOKUP[index], GL_TEXTURE_2D, tex->getId(), 0);
 	if( GL_FRAMEBUFFER_COMPLETE != glCheckFramebufferStatus(GL_FRAMEBUFFER) ) {
 		throw std::runtime_error("Texture could not add texture to framebuffer!");
 	}
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glstate::bindFramebuffer(previousFboId);
 	if( m_drawBuffers.size() <= std::size_t(index) ) {
 		m_drawBuffers.resize(index+1);
 	}
@@ -75,16 +78,19 @@ void FrameBuffer::addColorTexture( int index, std::shared_ptr<texture::Texture>
 
 
 void FrameBuffer::setDepthTexture(std::shared_ptr<texture::Texture> tex) {
-	glBindFramebuffer(GL_FRAMEBUFFER, m_fboId);
+	const auto previousFboId = glstate::getFramebuffer();
+	glstate::bindFramebuffer(m_fboId);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, tex->getId(), 0);
 	if (GL_FRAMEBUFFER_COMPLETE != glCheckFramebufferStatus(GL_FRAMEBUFFER)) {
 		throw std::runtime_error("Texture could not add texture to framebuffer!");
 	}
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glstate::bindFramebuffer(previousFboId);
 }
 
 void FrameBuffer::bind() {
-	glBindFramebuffer(GL_FRAMEBUFFER, m_fboId);
+	// Framebuffers may be nested, for example inside offscreen rendering of a headless window
+	m_previousFboId = glstate::getFramebuffer();
+	glstate::bindFramebuffer(m_fboId);
 	if( GL_FRAMEBUFFER_COMPLETE != glCheckFramebufferStatus(GL_FRAMEBUFFER) ) {
 		throw std::runtime_error("Texture could not add to framebuffer!");
 	}
@@ -93,8 +99,7 @@ void FrameBuffer::bind() {
 
 
 void FrameBuffer::unbind() {
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glstate::bindFramebuffer(m_previousFboId);
 }
 
 
@@ -0,0 +1,262 @@
+/*=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+ MIT License
+
+ Copyright (c) 2022 Mikko Romppainen (kajakbros@gmail.com)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
+#include <hungerland/frame_capture.h>
+#include <hungerland/util.h>
+#include <hungerland/gl_utils.h>
+#include <hungerland/gl_state.h>
+#include <glad/gl.h>
+#include <stb_image_write.h>
+#include <algorithm>
+#include <string.h>
+
+namespace hungerland {
+namespace graphics {
+
+	FrameCapture::FrameCapture(size_t numReadbacks)
+		: m_readbacks(std::max<size_t>(numReadbacks, 1))
+		, m_next(0)
+		, m_recordFile(0)
+		, m_recordWidth(0)
+		, m_recordHeight(0)
+		, m_numRecordedFrames(0)
+		, m_stopping(false) {
+		for(auto& readback : m_readbacks) {
+			glGenBuffers(1, &readback.pbo);
+		}
+		checkGLError();
+		m_worker = std::thread(&FrameCapture::work, this);
+	}
+
+	FrameCapture::~FrameCapture() {
+		finishAll();
+		stopRecording();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stopping = true;
+		}
+		m_jobAvailable.notify_all();
+		// Worker finishes queued screenshots and frames before it returns
+		m_worker.join();
+		for(auto& readback : m_readbacks) {
+			glDeleteBuffers(1, &readback.pbo);
+		}
+	}
+
+	void FrameCapture::requestScreenshot(const std::string& filename) {
+		m_screenshotFile = filename;
+	}
+
+	bool FrameCapture::startRecording(const std::string& filename) {
+		stopRecording();
+		m_recordFile = fopen(filename.c_str(), "wb");
+		if(m_recordFile == 0) {
+			util::WARN("Failed to open recording file: \"" + filename + "\"!");
+			return false;
+		}
+		m_numRecordedFrames = 0;
+		util::INFO("Recording frames to: " + filename);
+		return true;
+	}
+
+	void FrameCapture::stopRecording() {
+		if(m_recordFile == 0) {
+			return;
+		}
+		// Frames in flight are written before the file is closed
+		finishAll();
+		Job job;
+		job.recordFile = m_recordFile;
+		job.closeRecordFile = true;
+		pushJob(std::move(job));
+		m_recordFile = 0;
+		util::INFO("Recorded " + std::to_string(m_numRecordedFrames) + " frames of size "
+				   + std::to_string(m_recordWidth) + "x" + std::to_string(m_recordHeight));
+	}
+
+	bool FrameCapture::isRecording() const {
+		return m_recordFile != 0;
+	}
+
+	size_t FrameCapture::getNumRecordedFrames() const {
+		return m_numRecordedFrames;
+	}
+
+	void FrameCapture::capture(int width, int height) {
+		// Hand completed readbacks to the worker
+		while(!m_pending.empty() && finishOldest(false)) {
+		}
+
+		bool record = m_recordFile != 0;
+		if(record) {
+			if(m_numRecordedFrames == 0) {
+				m_recordWidth = width;
+				m_recordHeight = height;
+			} else if(width != m_recordWidth || height != m_recordHeight) {
+				util::WARN("Frame size changed, recording stopped");
+				stopRecording();
+				record = false;
+			}
+		}
+		if((m_screenshotFile.empty() && !record) || width <= 0 || height <= 0) {
+			return;
+		}
+
+		// Readbacks are used in ring order, so the next one is free unless all are in flight
+		if(m_pending.size() == m_readbacks.size()) {
+			finishOldest(true);
+		}
+		const size_t index = m_next;
+		m_next = (m_next + 1) % m_readbacks.size();
+		auto& readback = m_readbacks[index];
+
+		// Read asynchronously into the PBO
+		const size_t size = size_t(width) * height * 4;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+		checkGLError();
+		if(readback.capacity < size) {
+			glBufferData(GL_PIXEL_PACK_BUFFER, GLsizeiptr(size), 0, GL_STREAM_READ);
+			checkGLError();
+			readback.capacity = size;
+		}
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+		checkGLError();
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		checkGLError();
+		glstate::countCalls(4);
+
+		readback.width = width;
+		readback.height = height;
+		readback.screenshotFile = m_screenshotFile;
+		readback.record = record;
+		m_screenshotFile.clear();
+		m_pending.push_back(index);
+		if(record) {
+			++m_numRecordedFrames;
+		}
+	}
+
+	bool FrameCapture::finishOldest(bool wait) {
+		auto& readback = m_readbacks[m_pending.front()];
+		auto fence = static_cast<GLsync>(readback.fence);
+		GLenum result = glClientWaitSync(fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, 0);
+		while(wait && result == GL_TIMEOUT_EXPIRED) {
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		}
+		if(result == GL_TIMEOUT_EXPIRED) {
+			return false;
+		}
+		glDeleteSync(fence);
+		readback.fence = 0;
+		m_pending.pop_front();
+
+		Job job;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if(!m_freePixels.empty()) {
+				job.pixels = std::move(m_freePixels.back());
+				m_freePixels.pop_back();
+			}
+		}
+		const size_t size = size_t(readback.width) * readback.height * 4;
+		job.pixels.resize(size);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+		checkGLError();
+		const void* ptr = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(size), GL_MAP_READ_BIT);
+		checkGLError();
+		if(ptr != 0) {
+			memcpy(job.pixels.data(), ptr, size);
+		}
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		checkGLError();
+		glstate::countCalls(6);
+
+		job.width = readback.width;
+		job.height = readback.height;
+		job.screenshotFile = std::move(readback.screenshotFile);
+		job.recordFile = readback.record ? m_recordFile : 0;
+		pushJob(std::move(job));
+		return true;
+	}
+
+	void FrameCapture::finishAll() {
+		while(!m_pending.empty()) {
+			finishOldest(true);
+		}
+	}
+
+	void FrameCapture::pushJob(Job&& job) {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_jobs.push_back(std::move(job));
+		}
+		m_jobAvailable.notify_one();
+	}
+
+	void FrameCapture::work() {
+		for(;;) {
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_jobAvailable.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+				if(m_jobs.empty()) {
+					return;
+				}
+				job = std::move(m_jobs.front());
+				m_jobs.pop_front();
+			}
+
+			if(!job.pixels.empty()) {
+				// GL reads the bottom row first, files have the top row first. Alpha of the framebuffer is not opacity.
+				const size_t rowBytes = size_t(job.width) * 4;
+				for(int y = 0; y < job.height / 2; ++y) {
+					std::swap_ranges(&job.pixels[y * rowBytes], &job.pixels[y * rowBytes] + rowBytes, &job.pixels[(job.height - 1 - y) * rowBytes]);
+				}
+				for(size_t i = 3; i < job.pixels.size(); i += 4) {
+					job.pixels[i] = 0xff;
+				}
+				if(!job.screenshotFile.empty()) {
+					if(stbi_write_png(job.screenshotFile.c_str(), job.width, job.height, 4, job.pixels.data(), int(rowBytes)) != 0) {
+						util::INFO("Saved screenshot: " + job.screenshotFile);
+					} else {
+						util::WARN("Failed to save screenshot: " + job.screenshotFile);
+					}
+				}
+				if(job.recordFile != 0) {
+					fwrite(job.pixels.data(), 1, job.pixels.size(), job.recordFile);
+				}
+			}
+			if(job.closeRecordFile) {
+				fclose(job.recordFile);
+			}
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if(!job.pixels.empty() && m_freePixels.size() < m_readbacks.size()) {
+				m_freePixels.push_back(std::move(job.pixels));
+			}
+		}
+	}
+}
+}
@@ -33,26 +33,122 @@
 #include <stdexcept>
 
 namespace hungerland {
-	void checkGLError() {
-		GLenum err = glGetError();
-		if (err != GL_NO_ERROR) {
-			auto getErrorString = [](GLenum err) -> const char* const {
-				switch (err) {
-				case GL_NO_ERROR: return "GL_NO_ERROR";
-				case GL_INVALID_ENUM: return "GL_INVALID_ENUM";
-				case GL_INVALID_VALUE: return "GL_INVALID_VALUE";
-				case GL_INVALID_OPERATION: return "GL_INVALID_OPERATION";
-				case GL_INVALID_FRAMEBUFFER_OPERATION: return "GL_INVALID_FRAMEBUFFER_OPERATION";
-				case GL_OUT_OF_MEMORY: return "GL_OUT_OF_MEMORY";
-				default: return "Unknown error!";
+	namespace {
+		GLErrorMode g_errorMode = GLErrorMode::OFF;
+		// Error reported by the debug callback, until the next check reports it with the call site
+		std::string g_pendingError;
+
+		const char* getErrorString(GLenum err) {
+			switch (err) {
+			case GL_NO_ERROR: return "GL_NO_ERROR";
+			case GL_INVALID_ENUM: return "GL_INVALID_ENUM";
+			case GL_INVALID_VALUE: return "GL_INVALID_VALUE";
+			case GL_INVALID_OPERATION: return "GL_INVALID_OPERATION";
+			case GL_INVALID_FRAMEBUFFER_OPERATION: return "GL_INVALID_FRAMEBUFFER_OPERATION";
+			case GL_OUT_OF_MEMORY: return "GL_OUT_OF_MEMORY";
+			default: return "Unknown error!";
+			}
+		}
+
+		void debugCallback(GLenum, GLenum type, GLuint, GLenum severity, GLsizei, const GLchar* message, const void*) {
+			if(type == GL_DEBUG_TYPE_ERROR) {
+				if(g_pendingError.empty()) {
+					g_pendingError = message;
 				}
-			};
-			printf("OpenGL Error (%d): \"%s\"\n", (int)err, getErrorString(err));
-			util::ERR("OpenGL Error ("+std::to_string(err) + "): " + getErrorString(err));
+			} else if(severity == GL_DEBUG_SEVERITY_HIGH || severity == GL_DEBUG_SEVERITY_MEDIUM) {
+				util::WARN(std::string("OpenGL: ") + message);
+			}
+		}
+	}
+
+	void initGLErrorChecks() {
+#if HUNGERLAND_GL_CHECKS
+		GLint flags = 0;
+		glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+		if(GLAD_GL_KHR_debug && (flags & GL_CONTEXT_FLAG_DEBUG_BIT)) {
+			setGLErrorMode(GLErrorMode::DEBUG_OUTPUT);
+		} else {
+			setGLErrorMode(GLErrorMode::GET_ERROR);
+		}
+#endif
+	}
+
+	void setGLErrorMode([[maybe_unused]] GLErrorMode mode) {
+#if HUNGERLAND_GL_CHECKS
+		if(mode == GLErrorMode::DEBUG_OUTPUT && !GLAD_GL_KHR_debug) {
+			util::WARN("KHR_debug not supported, using glGetError");
+			mode = GLErrorMode::GET_ERROR;
+		}
+		if(GLAD_GL_KHR_debug) {
+			if(mode == GLErrorMode::DEBUG_OUTPUT) {
+				// Synchronous output calls the callback in the failing GL call, before the next check
+				glEnable(GL_DEBUG_OUTPUT);
+				glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+				glDebugMessageCallback(debugCallback, 0);
+				glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, 0, GL_TRUE);
+				glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, 0, GL_FALSE);
+			} else {
+				glDisable(GL_DEBUG_OUTPUT);
+				glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+			}
+		}
+		// Clear errors of earlier unchecked calls
+		clearGLErrors();
+		g_errorMode = mode;
+#endif
+	}
+
+	void clearGLErrors() {
+		while(glGetError() != GL_NO_ERROR) {
+		}
+		g_pendingError.clear();
+	}
+
+	GLErrorMode getGLErrorMode() {
+		return g_errorMode;
+	}
+
+	void checkGLErrorAt(const char* file, int line) {
+		auto where = [&]() {
+			return std::string(" at ") + file + ":" + std::to_string(line);
+		};
+		if(g_errorMode == GLErrorMode::DEBUG_OUTPUT) {
+			if(!g_pendingError.empty()) {
+				auto message = g_pendingError;
+				g_pendingError.clear();
+				util::ERR("OpenGL Error: " + message + where());
+			}
+		} else if(g_errorMode == GLErrorMode::GET_ERROR) {
+			GLenum err = glGetError();
+			if (err != GL_NO_ERROR) {
+				printf("OpenGL Error (%d): \"%s\"%s\n", (int)err, getErrorString(err), where().c_str());
+				util::ERR("OpenGL Error ("+std::to_string(err) + "): " + getErrorString(err) + where());
+			}
 		}
 	}
 
 	namespace shader_std {
+		// std140 blocks, see graphics::FrameData and graphics::LayerData
+		static inline std::string frameDataBlockSource() {
+			return
+				"layout (std140) uniform FrameData {\n"
+				"	mat4 P;\n"
+				"	vec4 camera;\n"
+				"};\n";
+		}
+
+		static inline std::string layerDataBlockSource() {
+			return
+				"layout (std140) uniform LayerData {\n"
+				"	vec2 offset;\n"
+				"	vec2 parallax;\n"
+				"	vec2 clipMin;\n"
+				"	vec2 clipMax;\n"
+				"	vec2 texCoordScale;\n"
+				"	float opacity;\n"
+				"};\n";
+		}
+
 		static inline std::string projectionVSSource(){
 			return
 				std::string("#version 330 core\n") +
@@ -82,6 +178,29 @@ namespace hungerland {
 				std::string("}");
 		}
 
+		static inline std::string spriteBatchVSSource() {
+			return
+				std::string("#version 330 core\n") +
+				std::string("layout (location = 0) in vec2 inPosition;\n") +
+				std::string("layout (location = 1) in vec2 inTexCoord;\n") +
+				// Per instance data (see graphics::SpriteBatch::Instance)
+				std::string("layout (location = 2) in vec4 inColumn0;\n") +
+				std::string("layout (location = 3) in vec4 inColumn1;\n") +
+				std::string("layout (location = 4) in vec4 inColumn3;\n") +
+				std::string("layout (location = 5) in vec4 inUvRect;\n") +
+				std::string("layout (location = 6) in vec4 inTint;\n") +
+				frameDataBlockSource() +
+				std::string("out vec2 texCoord;\n") +
+				std::string("out vec4 tint;\n") +
+				std::string("void main()\n") +
+				std::string("{\n") +
+				std::string("   mat4 M = mat4(inColumn0, inColumn1, vec4(0.0, 0.0, 1.0, 0.0), inColumn3);\n") +
+				std::string("   texCoord = mix(inUvRect.xy, inUvRect.zw, inTexCoord);\n") +
+				std::string("   tint = inTint;\n") +
+				std::string("   gl_Position = P*M*vec4(vec3(inPosition,0.0),1.0);\n") +
+				std::string("}");
+		}
+
 		static inline std::string shadeVSSource(){
 			return std::string(
 				std::string("#version 330 core\n") +
@@ -110,17 +229,19 @@ namespace hungerland {
 				std::string("#version 330 core\n") +
 				std::string("layout (location = 0) in vec2 inPosition;\n") +
 				std::string("layout (location = 1) in vec4 inTexCoord;\n") +
-				std::string("uniform mat4 P;\n") +
-				std::string("uniform vec2 offset = vec2(0, 0);\n") +
-				std::string("uniform vec2 parallax = vec2(1, 1);\n") +
+				// Visible rectangle of the quad (see map::applyLayerSubset) and texture coordinates per position unit are in LayerData
+				frameDataBlockSource() +
+				layerDataBlockSource() +
 				std::string("out vec2 texCoord;") +
 				std::string("out vec2 worldPos;") +
 				std::string("void main() {\n") +
-				std::string("    vec4 pos = vec4(inPosition.x+parallax.x+offset.x,inPosition.y+parallax.y+offset.y, 0.0, 1.0);\n") +
+				std::string("    vec2 position = clamp(inPosition, clipMin, clipMax);\n") +
+				std::string("    vec2 delta = position - inPosition;\n") +
+				std::string("    vec4 pos = vec4(position.x+parallax.x+offset.x,position.y+parallax.y+offset.y, 0.0, 1.0);\n") +
 				std::string("    vec4 p = P*pos;\n") +
-				std::string("    texCoord  = inTexCoord.xy;\n") +
-				std::string("    worldPos.x = inTexCoord.z;\n") +
-				std::string("    worldPos.y = inTexCoord.w;\n") +
+				std::string("    texCoord  = inTexCoord.xy + delta*texCoordScale;\n") +
+				std::string("    worldPos.x = inTexCoord.z + delta.x;\n") +
+				std::string("    worldPos.y = inTexCoord.w + delta.y;\n") +
 				std::string("    gl_Position = p;\n") +
 				std::string("}\n");
 		}
@@ -159,12 +280,56 @@ namespace hungerland {
 				std::string("FragColor = color;\n}\n");
 		}
 
+		static inline std::string postProcessVSSource(){
+			return
+				std::string("#version 330 core\n") +
+				std::string("layout (location = 0) in vec2 inPosition;\n") +
+				std::string("layout (location = 1) in vec2 inTexCoord;\n") +
+				std::string("out vec2 texCoord;\n") +
+				std::string("void main()\n") +
+				std::string("{\n") +
+				std::string("   texCoord = inTexCoord;\n") +
+				std::string("   gl_Position = vec4(inPosition, 0.0, 1.0);\n") +
+				std::string("}");
+		}
+
+		static inline std::string postProcessFSSource(const std::string& inputUniforms, const std::string& globals, const std::string& shader){
+			return
+				std::string("#version 330 core\n") +
+				std::string("in vec2 texCoord;\n") +
+				std::string("out vec4 FragColor;\n")
+				+ inputUniforms + "\n" +
+				std::string("uniform sampler2D texture0;\n") +
+				std::string("uniform sampler2D texture1;\n") +
+				std::string("uniform vec2 texelSize;\n")
+				+ globals + "\n" +
+				std::string("void main(){\n") +
+				std::string("vec4 color = texture(texture0, texCoord);\n") +
+				shader +
+				std::string("FragColor = color;\n}\n");
+		}
+
+		static inline std::string spriteBatchFSSource(const std::string& inputUniforms, const std::string& globals, const std::string& shader){
+			return
+				std::string("#version 330 core\n") +
+				std::string("in vec2 texCoord;\n") +
+				std::string("in vec4 tint;\n") +
+				std::string("out vec4 FragColor;\n")
+				+ inputUniforms + "\n" +
+				std::string("uniform sampler2D texture0;\n")
+				+ globals + "\n" +
+				std::string("void main(){\n") +
+				std::string("vec4 color = texture(texture0, texCoord) * tint;\n") +
+				shader +
+				std::string("FragColor = color;\n}\n");
+		}
+
 		static std::string mapImageLayerFSSource() {
 			return
 				std::string("#version 330 core\n") +
 				"in vec2 texCoord;\n"
-				"uniform sampler2D image;\n"
-				"uniform float opacity = 1;\n"
+				"uniform sampler2D image;\n" +
+				layerDataBlockSource() +
 				"uniform vec2 repeat = vec2(0);\n"
 				"out vec4 FragColor;\n"
 				"void main() {\n"
@@ -226,17 +391,23 @@ namespace hungerland {
 				tileFSSource() +
 				"in vec2 texCoord;\n"
 				"uniform vec2 tileSize;\n"
-				"uniform vec2 tilesetSize ;\n"
-				"uniform float opacity;\n"
-				"uniform sampler2D lookupMap;\n"
+				"uniform vec2 tilesetSize ;\n" +
+				layerDataBlockSource() +
+				// Global tile id and flip flags of each tile (see map::fillLookup)
+				"uniform usampler2D lookupMap;\n"
 				"uniform sampler2D tileMap;\n"
+				"uniform int firstGID;\n"
+				"uniform int tileCount;\n"
 				"out vec4 FragColor;\n"
 				"void main() {\n"
-				"	vec4 values = texture(lookupMap, texCoord);\n"
-				"	if(values.r > 0.0) {\n"
-				"		vec2 position = getTilePosition(values.r, tilesetSize);\n"
-				"		vec2 texelSize = vec2(1.0) / textureSize(lookupMap, 0);\n"
-				"		vec2 offset = getTileOffset(values.g, texCoord, texelSize, tileSize, tilesetSize);\n"
+				"	ivec2 lookupSize = textureSize(lookupMap, 0);\n"
+				"	ivec2 lookupPos = clamp(ivec2(texCoord * vec2(lookupSize)), ivec2(0), lookupSize - 1);\n"
+				"	uint value = texelFetch(lookupMap, lookupPos, 0).r;\n"
+				"	int tileIndex = int(value & 0x0FFFFFFFu) - firstGID + 1;\n"
+				"	if(tileIndex > 0 && tileIndex <= tileCount) {\n"
+				"		vec2 position = getTilePosition(float(tileIndex), tilesetSize);\n"
+				"		vec2 texelSize = vec2(1.0) / vec2(lookupSize);\n"
+				"		vec2 offset = getTileOffset(float(value >> 28u), texCoord, texelSize, tileSize, tilesetSize);\n"
 				"       vec4 color = texture(tileMap, position + offset);\n"
 				"		color.a = min(opacity, color.a);\n"
 				"		FragColor = color;\n"
@@ -245,27 +416,79 @@ namespace hungerland {
 				"	}\n"
 				"}";
 		}
+
+		// Same as mapTileMapFSSource, but all tilesets of the map are layers of one texture array,
+		// so a whole tile layer (or chunk) is drawn with a single draw call.
+		static std::string mapTileArrayFSSource(size_t maxTilesets) {
+			return
+				std::string("#version 330 core\n") +
+				"#define MAX_TILESETS " + std::to_string(maxTilesets) + "\n" +
+				tileFSSource() +
+				"in vec2 texCoord;\n" +
+				layerDataBlockSource() +
+				"uniform usampler2D lookupMap;\n"
+				"uniform sampler2DArray tileMaps;\n"
+				"uniform int numTilesets;\n"
+				"uniform int firstGID[MAX_TILESETS];\n"
+				"uniform int tileCount[MAX_TILESETS];\n"
+				"uniform vec2 tileSize[MAX_TILESETS];\n"
+				"uniform vec2 tilesetSize[MAX_TILESETS];\n"
+				// Size of the tileset image relative to the array layer size
+				"uniform vec2 uvScale[MAX_TILESETS];\n"
+				"out vec4 FragColor;\n"
+				"void main() {\n"
+				"	ivec2 lookupSize = textureSize(lookupMap, 0);\n"
+				"	ivec2 lookupPos = clamp(ivec2(texCoord * vec2(lookupSize)), ivec2(0), lookupSize - 1);\n"
+				"	uint value = texelFetch(lookupMap, lookupPos, 0).r;\n"
+				"	int gid = int(value & 0x0FFFFFFFu);\n"
+				"	FragColor = vec4(0,0,0,0);\n"
+				"	for(int i = 0; i < numTilesets; ++i) {\n"
+				"		int tileIndex = gid - firstGID[i] + 1;\n"
+				"		if(tileIndex > 0 && tileIndex <= tileCount[i]) {\n"
+				"			vec2 position = getTilePosition(float(tileIndex), tilesetSize[i]);\n"
+				"			vec2 texelSize = vec2(1.0) / vec2(lookupSize);\n"
+				"			vec2 offset = getTileOffset(float(value >> 28u), texCoord, texelSize, tileSize[i], tilesetSize[i]);\n"
+				"			vec4 color = texture(tileMaps, vec3((position + offset) * uvScale[i], float(i)));\n"
+				"			color.a = min(opacity, color.a);\n"
+				"			FragColor = color;\n"
+				"			break;\n"
+				"		}\n"
+				"	}\n"
+				"}";
+		}
 	} // End - namespace shader_source
 
 	namespace shaders {
 		shader::Shader::Ref createPasstrough() {
-			return std::make_unique<shader::Shader>(shader_std::projectionVSSource(), shader_std::textureFSSource("","",""));
+			return shader::getCached(shader_std::projectionVSSource(), shader_std::textureFSSource("","",""));
 		}
 
 		shader::Shader::Ref createTileLayer() {
-			return std::make_shared<shader::Shader>(shader_std::mapVSSource(), shader_std::mapTileMapFSSource());
+			return shader::getCached(shader_std::mapVSSource(), shader_std::mapTileMapFSSource());
+		}
+
+		shader::Shader::Ref createTileLayerArray(size_t maxTilesets) {
+			return shader::getCached(shader_std::mapVSSource(), shader_std::mapTileArrayFSSource(maxTilesets));
 		}
 
 		shader::Shader::Ref createImageLayer() {
-			return std::make_shared<shader::Shader>(shader_std::mapVSSource(), shader_std::mapImageLayerFSSource());
+			return shader::getCached(shader_std::mapVSSource(), shader_std::mapImageLayerFSSource());
 		}
 
 		shader::Shader::Ref createShade(const std::vector<shader::Constant>& constants, const std::string& fragmentShaderMain, const std::string& globals) {
-			return std::make_shared<shader::Shader>(shader_std::shadeVSSource(), shader_std::shadeFSSource(shader::to_string(constants), globals, fragmentShaderMain));
+			return shader::getCached(shader_std::shadeVSSource(), shader_std::shadeFSSource(shader::to_string(constants), globals, fragmentShaderMain));
 		}
 
 		shader::Shader::Ref createSprite(const std::vector<shader::Constant>& constants, const std::string& surfaceShader, const std::string& globals) {
-			return std::make_shared<shader::Shader>(shader_std::modelProjectionVSSource(), shader_std::textureFSSource("", globals, surfaceShader));
+			return shader::getCached(shader_std::modelProjectionVSSource(), shader_std::textureFSSource("", globals, surfaceShader));
+		}
+
+		shader::Shader::Ref createSpriteBatch(const std::vector<shader::Constant>& constants, const std::string& surfaceShader, const std::string& globals) {
+			return shader::getCached(shader_std::spriteBatchVSSource(), shader_std::spriteBatchFSSource(shader::to_string(constants), globals, surfaceShader));
+		}
+
+		shader::Shader::Ref createPostProcess(const std::vector<shader::Constant>& constants, const std::string& surfaceShader, const std::string& globals) {
+			return shader::getCached(shader_std::postProcessVSSource(), shader_std::postProcessFSSource(shader::to_string(constants), globals, surfaceShader));
 		}
 	} // End - namespace shaders
 }
@@ -36,45 +36,57 @@
 #include <hungerland/texture.h>
 #include <hungerland/texture.h>
 #include <hungerland/gl_utils.h>
+#include <hungerland/gl_state.h>
 
 
 namespace hungerland {
 namespace mesh {
+	namespace {
+		void uploadVBOData(unsigned vbo, size_t& allocatedSize, const void* data, size_t size, bool dynamic) {
+			glBindBuffer(GL_ARRAY_BUFFER, vbo);
+			checkGLError();
+			if(size > 0 && size <= allocatedSize) {
+				// Update in place, glBufferData would reallocate the storage
+				glBufferSubData(GL_ARRAY_BUFFER, 0, size, data);
+				checkGLError();
+			} else {
+				glBufferData(GL_ARRAY_BUFFER, size, data, dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+				checkGLError();
+				allocatedSize = size;
+			}
+			glstate::countCalls(2);
+		}
+	}
+
 	Mesh::~Mesh() {
-		glDeleteVertexArrays(1, &vao);
+		glstate::deleteVertexArray(vao);
 		glDeleteBuffers(sizeof(vbos)/sizeof(vbos[0]), vbos);
 	}
 	void Mesh::setVBOData(int index, const std::vector<float>& data, size_t numComponents, bool dynamic) {
-		glBindVertexArray(vao);
+		glstate::bindVertexArray(vao);
 		checkGLError();
 
-		glBindBuffer(GL_ARRAY_BUFFER, vbos[index]);
-		checkGLError();
-		glBufferData(GL_ARRAY_BUFFER, data.size()*sizeof(data[0]), &data[0], dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
-		checkGLError();
+		uploadVBOData(vbos[index], vboSizes[index], data.data(), data.size()*sizeof(data[0]), dynamic);
 		glVertexAttribPointer(index, int(numComponents), GL_FLOAT, GL_FALSE, int(numComponents * sizeof(float)), (void*)0);
 		checkGLError();
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		// Attributes are enabled once, the vertex array remembers them
+		glEnableVertexAttribArray(index);
 		checkGLError();
-
-		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
 		checkGLError();
 	}
 
 	void Mesh::setVBOData(int index, const std::vector<glm::vec2>& data, bool dynamic) {
-		glBindVertexArray(vao);
+		glstate::bindVertexArray(vao);
 		checkGLError();
 
-		glBindBuffer(GL_ARRAY_BUFFER, vbos[index]);
-		checkGLError();
-		glBufferData(GL_ARRAY_BUFFER, data.size()*sizeof(data[0]), &data[0], dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
-		checkGLError();
+		uploadVBOData(vbos[index], vboSizes[index], data.data(), data.size()*sizeof(data[0]), dynamic);
 		glVertexAttribPointer(index, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
 		checkGLError();
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		// Attributes are enabled once, the vertex array remembers them
+		glEnableVertexAttribArray(index);
 		checkGLError();
-
-		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
 		checkGLError();
 	}
 
@@ -106,23 +118,12 @@ namespace mesh {
 	}
 
 	void draw(const Mesh& mesh, int mode, unsigned count) {
-		// Bind
-		glBindVertexArray(mesh.vao);
+		// Bind. Vertex attributes are enabled in the vertex array and it stays bound for the next draw.
+		glstate::bindVertexArray(mesh.vao);
 		checkGLError();
-		int numVertexArrys = sizeof(mesh.vbos)/sizeof(mesh.vbos[0]);
-		for(size_t i=0; i<numVertexArrys; ++i){
-			glEnableVertexAttribArray(int(i));
-			checkGLError();
-		}
 		// Draw
 		glDrawArrays(mode, 0, count);
-		checkGLError();
-		// Unbind
-		for(size_t i=0; i<numVertexArrys; ++i){
-			glDisableVertexAttribArray((unsigned)i);
-			checkGLError();
-		}
-		glBindVertexArray(0);
+		glstate::countDraw();
 		checkGLError();
 	};
 
@@ -0,0 +1,216 @@
+/*=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+ MIT License
+
+ Copyright (c) 2022 Mikko Romppainen (kajakbros@gmail.com)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
+#include <hungerland/post_process.h>
+#include <hungerland/framebuffer.h>
+#include <hungerland/graphics.h>
+#include <hungerland/mesh.h>
+#include <hungerland/texture.h>
+#include <hungerland/gl_utils.h>
+#include <hungerland/gl_state.h>
+#include <glad/gl.h>
+#include <algorithm>
+#include <stdexcept>
+#include <assert.h>
+
+namespace hungerland {
+namespace graphics {
+
+	RenderTargetPool::RenderTargetPool() {
+	}
+
+	RenderTargetPool::~RenderTargetPool() {
+	}
+
+	RenderTargetPool::Target* RenderTargetPool::acquire(unsigned width, unsigned height, Format format) {
+		for(auto& target : m_targets) {
+			if(!target->inUse && target->width == width && target->height == height && target->format == format) {
+				target->inUse = true;
+				target->lastUsedFrame = glstate::getFrameNumber();
+				return target.get();
+			}
+		}
+		auto target = std::make_unique<Target>();
+		if(format == Format::RGBA32F) {
+			target->texture = std::make_shared<texture::Texture>(width, height, 4, (const float*)0);
+		} else {
+			target->texture = std::make_shared<texture::Texture>(width, height, false);
+		}
+		// Scaled passes are sampled with bilinear filtering
+		target->texture->setFiltering(true);
+		target->frameBuffer = std::make_unique<FrameBuffer>();
+		target->frameBuffer->addColorTexture(0, target->texture);
+		target->width = width;
+		target->height = height;
+		target->format = format;
+		target->inUse = true;
+		target->lastUsedFrame = glstate::getFrameNumber();
+		m_targets.push_back(std::move(target));
+		return m_targets.back().get();
+	}
+
+	void RenderTargetPool::release(Target* target) {
+		assert(target != 0 && target->inUse);
+		target->inUse = false;
+	}
+
+	void RenderTargetPool::trim(size_t maxUnusedFrames) {
+		const auto frame = glstate::getFrameNumber();
+		m_targets.erase(std::remove_if(m_targets.begin(), m_targets.end(), [&](const std::unique_ptr<Target>& target) {
+			return !target->inUse && frame - target->lastUsedFrame >= maxUnusedFrames;
+		}), m_targets.end());
+	}
+
+	size_t RenderTargetPool::getNumTargets() const {
+		return m_targets.size();
+	}
+
+
+	PostProcessChain::PostProcessChain(std::shared_ptr<RenderTargetPool> pool)
+		: m_pool(pool)
+		, m_output(0)
+		, m_format(RenderTargetPool::Format::RGBA8) {
+		// Fullscreen quad in normalized device coordinates. Texture coordinates follow framebuffer texture orientation.
+		static const std::vector<glm::vec2> POSITIONS({
+			glm::vec2( 1, -1),
+			glm::vec2( 1,  1),
+			glm::vec2(-1,  1),
+			glm::vec2( 1, -1),
+			glm::vec2(-1,  1),
+			glm::vec2(-1, -1)
+		});
+		static const std::vector<glm::vec2> TEXTURE_COORDS({
+			glm::vec2(1,0),
+			glm::vec2(1,1),
+			glm::vec2(0,1),
+			glm::vec2(1,0),
+			glm::vec2(0,1),
+			glm::vec2(0,0)
+		});
+		m_quad = mesh::create(POSITIONS, TEXTURE_COORDS);
+	}
+
+	PostProcessChain::~PostProcessChain() {
+		if(m_output != 0) {
+			m_pool->release(m_output);
+		}
+	}
+
+	void PostProcessChain::addPass(const std::string& name, const std::string& shader, float resolutionScale,
+		const shader::Constants& constants, const std::string& globals) {
+		assert(resolutionScale > 0.0f);
+		Pass pass;
+		pass.name = name;
+		pass.shader = shaders::createPostProcess(constants, shader, globals);
+		pass.constants = constants;
+		pass.resolutionScale = resolutionScale;
+		pass.enabled = true;
+		m_passes.push_back(std::move(pass));
+	}
+
+	void PostProcessChain::setEnabled(const std::string& name, bool enabled) {
+		find(name).enabled = enabled;
+	}
+
+	void PostProcessChain::setConstants(const std::string& name, const shader::Constants& constants) {
+		auto& pass = find(name);
+		for(auto& c : constants) {
+			auto it = std::find_if(pass.constants.begin(), pass.constants.end(), [&](const shader::Constant& passConstant) {
+				return passConstant.first == c.first;
+			});
+			assert(it != pass.constants.end() && it->second.size() == c.second.size());
+			if(it != pass.constants.end()) {
+				it->second = c.second;
+			}
+		}
+	}
+
+	void PostProcessChain::setFormat(RenderTargetPool::Format format) {
+		m_format = format;
+	}
+
+	const texture::Texture& PostProcessChain::apply(const texture::Texture& input) {
+		if(m_output != 0) {
+			m_pool->release(m_output);
+			m_output = 0;
+		}
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		checkGLError();
+		const bool blend = glstate::isBlendEnabled();
+		glstate::setBlend(false);
+
+		const texture::Texture* source = &input;
+		RenderTargetPool::Target* previous = 0;
+		for(auto& pass : m_passes) {
+			if(!pass.enabled) {
+				continue;
+			}
+			const auto width = std::max(1u, unsigned(float(input.getWidth()) * pass.resolutionScale + 0.5f));
+			const auto height = std::max(1u, unsigned(float(input.getHeight()) * pass.resolutionScale + 0.5f));
+			auto target = m_pool->acquire(width, height, m_format);
+			target->frameBuffer->use([&]() {
+				glViewport(0, 0, GLsizei(width), GLsizei(height));
+				checkGLError();
+				pass.shader->use([&](shader::ShaderPass shader) {
+					glstate::bindTexture(0, GL_TEXTURE_2D, source->getId());
+					glstate::bindTexture(1, GL_TEXTURE_2D, input.getId());
+					shader.setUniform("texture0", 0);
+					shader.setUniform("texture1", 1);
+					shader.setUniform("texelSize", 1.0f / float(width), 1.0f / float(height));
+					for(auto& c : pass.constants) {
+						shader.setUniformv(c.first, c.second);
+					}
+					quad::draw(*m_quad);
+				});
+			});
+			// Output of the pass before previous is free again, so passes of same size ping-pong between two targets
+			if(previous != 0) {
+				m_pool->release(previous);
+			}
+			previous = target;
+			source = target->texture.get();
+		}
+		m_output = previous;
+
+		glstate::setBlend(blend);
+		glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+		checkGLError();
+		return *source;
+	}
+
+	size_t PostProcessChain::getNumPasses() const {
+		return m_passes.size();
+	}
+
+	PostProcessChain::Pass& PostProcessChain::find(const std::string& name) {
+		for(auto& pass : m_passes) {
+			if(pass.name == name) {
+				return pass;
+			}
+		}
+		throw std::runtime_error("Post process pass \"" + name + "\" not found!");
+	}
+
+}
+}
@@ -27,6 +27,7 @@
 #include <hungerland/texture.h>
 #include <hungerland/mesh.h>
 #include <hungerland/gl_utils.h>
+#include <hungerland/gl_state.h>
 #include <glad/gl.h>		// Include glad
 
 
@@ -42,9 +43,11 @@ namespace screen {
 		// Create sprite and screen size quad meshes
 		m_ssqShader = shaders::createPasstrough();
 		m_sprite = quad::createSprite(0.5, 0.5);
+		m_spriteBatch = std::make_unique<graphics::SpriteBatch>();
+		m_renderQueue = std::make_unique<graphics::RenderQueue>(*m_spriteBatch);
 		// Enable alpha blending:
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glstate::setBlend(true);
+		glstate::setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	}
 
 	void Screen::clear(float r, float g, float b, float a) {
@@ -78,13 +81,13 @@ namespace screen {
 	}
 
 	void Screen::drawSprite(const glm::mat4& matModel, const texture::Texture& texture, const std::vector<shader::Constant>& constants, const std::string& surfaceShader, const std::string& globals) {
+		// Sprite shaders are compiled only once by the shader cache
 		auto spriteShader = shaders::createSprite(constants, surfaceShader, globals);
 		spriteShader->use([&](shader::ShaderPass shader) {
 			shader.setUniformm("P", &m_projection[0][0]);
 			shader.setUniformm("M", &matModel[0][0]);
 			shader.setUniform("texture0", 0);
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, texture.getId());
+			glstate::bindTexture(0, GL_TEXTURE_2D, texture.getId());
 			for(auto& c : constants){
 				shader.setUniformv(c.first,c.second);
 			}
@@ -93,12 +96,23 @@ namespace screen {
 		});
 	}
 
+	graphics::SpriteBatch& Screen::getSpriteBatch() {
+		return *m_spriteBatch;
+	}
+
+	graphics::RenderQueue& Screen::getRenderQueue() {
+		return *m_renderQueue;
+	}
+
+	const glm::mat4& Screen::getProjection() const {
+		return m_projection;
+	}
+
 	void Screen::drawScreenSizeQuad(const texture::Texture& texture) {
 		m_ssqShader->use([&](shader::ShaderPass shader) {
 			shader.setUniformm("P", &m_projection[0][0]);
 			shader.setUniform("texture0", 0);
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, texture.getId());
+			glstate::bindTexture(0, GL_TEXTURE_2D, texture.getId());
 			// Render screen size quad
 			quad::draw(*m_ssq);
 		});
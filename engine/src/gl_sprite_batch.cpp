@@ -0,0 +1,208 @@
+/*=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+ MIT License
+
+ Copyright (c) 2022 Mikko Romppainen (kajakbros@gmail.com)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
+#include <hungerland/sprite_batch.h>
+#include <hungerland/graphics.h>
+#include <hungerland/uniform_buffer.h>
+#include <hungerland/stream_buffer.h>
+#include <hungerland/texture.h>
+#include <hungerland/gl_utils.h>
+#include <hungerland/gl_state.h>
+#include <hungerland/util.h>
+#include <glad/gl.h>
+#include <algorithm>
+#include <assert.h>
+
+namespace hungerland {
+namespace graphics {
+
+	SpriteBatch::SpriteBatch(size_t initialCapacity)
+		: m_defaultShader(shaders::createSpriteBatch({}, "", ""))
+		, m_uniformBuffer(std::make_unique<UniformBuffer>(4*1024))
+		, m_instanceBuffer(std::make_unique<StreamBuffer>(4 * std::max<size_t>(initialCapacity, 1) * sizeof(Instance)))
+		, m_projection(1)
+		, m_sortMode(SortMode::TEXTURE)
+		, m_numDrawCalls(0)
+		, m_begun(false)
+		, m_vao(0)
+		, m_quadVbo(0) {
+		// Unit quad as triangle strip: position xy, texture coordinate uv
+		static const float QUAD[] = {
+			-0.5f, -0.5f,	0.0f, 0.0f,
+			 0.5f, -0.5f,	1.0f, 0.0f,
+			-0.5f,  0.5f,	0.0f, 1.0f,
+			 0.5f,  0.5f,	1.0f, 1.0f,
+		};
+		glGenVertexArrays(1, &m_vao);
+		checkGLError();
+		glGenBuffers(1, &m_quadVbo);
+		checkGLError();
+		glstate::bindVertexArray(m_vao);
+		checkGLError();
+
+		glBindBuffer(GL_ARRAY_BUFFER, m_quadVbo);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(QUAD), QUAD, GL_STATIC_DRAW);
+		checkGLError();
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+		checkGLError();
+
+		m_instanceBuffer->bind();
+		for(unsigned i = 2; i <= 6; ++i) {
+			glEnableVertexAttribArray(i);
+			glVertexAttribDivisor(i, 1);
+		}
+		checkGLError();
+		setInstanceOffset(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		checkGLError();
+	}
+
+	SpriteBatch::~SpriteBatch() {
+		glstate::deleteVertexArray(m_vao);
+		glDeleteBuffers(1, &m_quadVbo);
+	}
+
+	void SpriteBatch::begin(const glm::mat4& projection, SortMode sortMode) {
+		assert(!m_begun);
+		m_projection = projection;
+		m_sortMode = sortMode;
+		m_sprites.clear();
+		// Shaders of the previous batch may be released, so their uniform handles are not kept
+		m_textureUniforms.clear();
+		m_begun = true;
+	}
+
+	void SpriteBatch::draw(const texture::Texture& texture, const glm::mat4& transform, const glm::vec4& uvRect, const glm::vec4& tint, const shader::Shader* shader) {
+		draw(texture.getId(), {transform[0], transform[1], transform[3], uvRect, tint}, shader);
+	}
+
+	void SpriteBatch::draw(unsigned textureId, const Instance& instance, const shader::Shader* shader) {
+		assert(m_begun);
+		m_sprites.push_back({shader != 0 ? shader : m_defaultShader.get(), textureId, instance});
+	}
+
+	void SpriteBatch::end() {
+		assert(m_begun);
+		m_begun = false;
+		m_numDrawCalls = 0;
+		if(m_sprites.empty()) {
+			return;
+		}
+
+		// Order sprites so that sprites of each draw call are consecutive
+		m_order.resize(m_sprites.size());
+		for(size_t i = 0; i < m_order.size(); ++i) {
+			m_order[i] = i;
+		}
+		if(m_sortMode == SortMode::TEXTURE) {
+			std::stable_sort(m_order.begin(), m_order.end(), [this](size_t a, size_t b) {
+				const auto& sa = m_sprites[a];
+				const auto& sb = m_sprites[b];
+				if(sa.shader != sb.shader) {
+					return sa.shader < sb.shader;
+				}
+				return sa.textureId < sb.textureId;
+			});
+		}
+		m_instances.resize(m_sprites.size());
+		for(size_t i = 0; i < m_order.size(); ++i) {
+			m_instances[i] = m_sprites[m_order[i]].instance;
+		}
+
+		// Append all instances at once to the stream buffer. It waits only for the GPU frames, that used the range.
+		const size_t size = m_instances.size() * sizeof(Instance);
+		if(size > m_instanceBuffer->getCapacity()) {
+			size_t capacity = m_instanceBuffer->getCapacity();
+			while(capacity < size) {
+				capacity *= 2;
+			}
+			// Draws in flight keep the storage of the old buffer
+			m_instanceBuffer = std::make_unique<StreamBuffer>(capacity);
+		}
+		const size_t base = m_instanceBuffer->write(m_instances.data(), size);
+		glstate::bindVertexArray(m_vao);
+		checkGLError();
+		m_instanceBuffer->bind();
+
+		// Projection is shared by all sprite shaders through the FrameData block
+		FrameData frameData;
+		frameData.P = m_projection;
+		frameData.camera = glm::vec4(0.0f);
+		m_uniformBuffer->push(shader::FRAME_DATA_BINDING, frameData);
+
+		// One instanced draw per run of sprites with same shader and texture
+		size_t first = 0;
+		while(first < m_order.size()) {
+			const auto& key = m_sprites[m_order[first]];
+			size_t last = first + 1;
+			while(last < m_order.size() && m_sprites[m_order[last]].shader == key.shader && m_sprites[m_order[last]].textureId == key.textureId) {
+				++last;
+			}
+			const auto textureUniform = getTextureUniform(*key.shader);
+			key.shader->use([&](shader::ShaderPass shader) {
+				shader.setUniform(textureUniform, 0);
+				glstate::bindTexture(0, GL_TEXTURE_2D, key.textureId);
+				checkGLError();
+				// Base instance requires GL 4.2, so instance attributes are pointed to the first sprite of the run
+				glstate::bindVertexArray(m_vao);
+				setInstanceOffset(base + first * sizeof(Instance));
+				glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, GLsizei(last - first));
+				glstate::countDraw();
+				checkGLError();
+			});
+			++m_numDrawCalls;
+			first = last;
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		checkGLError();
+	}
+
+	const shader::Uniform* SpriteBatch::getTextureUniform(const shader::Shader& shader) {
+		// Batches use only a few shaders, so handles are searched linearly
+		for(const auto& textureUniform : m_textureUniforms) {
+			if(textureUniform.first == &shader) {
+				return textureUniform.second;
+			}
+		}
+		const auto uniform = shader.findUniform("texture0");
+		m_textureUniforms.push_back({&shader, uniform});
+		return uniform;
+	}
+
+	size_t SpriteBatch::getNumDrawCalls() const {
+		return m_numDrawCalls;
+	}
+
+	void SpriteBatch::setInstanceOffset(size_t base) {
+		// Expects VAO and instance buffer to be bound. Base is byte offset of the first instance.
+		for(unsigned i = 0; i < 5; ++i) {
+			glVertexAttribPointer(2 + i, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)(base + i * sizeof(glm::vec4)));
+		}
+		glstate::countCalls(5);
+		checkGLError();
+	}
+}
+}
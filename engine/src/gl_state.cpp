@@ -0,0 +1,248 @@
+/*=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+ MIT License
+
+ Copyright (c) 2022 Mikko Romppainen (kajakbros@gmail.com)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
+#include <hungerland/gl_state.h>
+#include <glad/gl.h>
+
+namespace hungerland {
+namespace glstate {
+	namespace {
+		const unsigned UNKNOWN = ~0u;
+		const unsigned MAX_TEXTURE_UNITS = 32;
+
+		struct State {
+			unsigned program = UNKNOWN;
+			unsigned vao = UNKNOWN;
+			unsigned activeUnit = UNKNOWN;
+			unsigned textures[MAX_TEXTURE_UNITS][2];	// GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY
+			int blend = -1;
+			unsigned blendSrc = UNKNOWN;
+			unsigned blendDst = UNKNOWN;
+			unsigned fbo = UNKNOWN;
+			Stats frame;
+			Stats lastFrame;
+			size_t frameNumber = 0;
+
+			State() {
+				forget();
+			}
+
+			void forget() {
+				program = vao = activeUnit = fbo = blendSrc = blendDst = UNKNOWN;
+				blend = -1;
+				for(auto& unit : textures) {
+					unit[0] = unit[1] = UNKNOWN;
+				}
+			}
+		};
+
+		State& getState() {
+			static State state;
+			return state;
+		}
+
+		int getTargetIndex(unsigned target) {
+			if(target == GL_TEXTURE_2D) {
+				return 0;
+			} else if(target == GL_TEXTURE_2D_ARRAY) {
+				return 1;
+			}
+			return -1;
+		}
+
+		// Returns true, if value changed and GL call must be issued
+		bool change(unsigned& shadow, unsigned value) {
+			auto& state = getState();
+			if(shadow == value) {
+				++state.frame.skippedCalls;
+				return false;
+			}
+			shadow = value;
+			++state.frame.glCalls;
+			return true;
+		}
+	}
+
+	void useProgram(unsigned program) {
+		if(change(getState().program, program)) {
+			glUseProgram(program);
+		}
+	}
+
+	void bindVertexArray(unsigned vao) {
+		if(change(getState().vao, vao)) {
+			glBindVertexArray(vao);
+		}
+	}
+
+	void activeTexture(unsigned unit) {
+		if(change(getState().activeUnit, unit)) {
+			glActiveTexture(GL_TEXTURE0 + unit);
+		}
+	}
+
+	void bindTexture(unsigned unit, unsigned target, unsigned texture) {
+		auto& state = getState();
+		const auto targetIndex = getTargetIndex(target);
+		if(targetIndex >= 0 && unit < MAX_TEXTURE_UNITS && state.textures[unit][targetIndex] == texture) {
+			++state.frame.skippedCalls;
+			return;
+		}
+		activeTexture(unit);
+		bindTexture(target, texture);
+	}
+
+	void bindTexture(unsigned target, unsigned texture) {
+		auto& state = getState();
+		const auto targetIndex = getTargetIndex(target);
+		if(targetIndex >= 0 && state.activeUnit < MAX_TEXTURE_UNITS) {
+			if(!change(state.textures[state.activeUnit][targetIndex], texture)) {
+				return;
+			}
+		} else {
+			++state.frame.glCalls;
+		}
+		glBindTexture(target, texture);
+	}
+
+	void setBlend(bool enabled) {
+		auto& state = getState();
+		if(state.blend == int(enabled)) {
+			++state.frame.skippedCalls;
+			return;
+		}
+		state.blend = int(enabled);
+		++state.frame.glCalls;
+		if(enabled) {
+			glEnable(GL_BLEND);
+		} else {
+			glDisable(GL_BLEND);
+		}
+	}
+
+	void setBlendFunc(unsigned srcFactor, unsigned dstFactor) {
+		auto& state = getState();
+		if(state.blendSrc == srcFactor && state.blendDst == dstFactor) {
+			++state.frame.skippedCalls;
+			return;
+		}
+		state.blendSrc = srcFactor;
+		state.blendDst = dstFactor;
+		++state.frame.glCalls;
+		glBlendFunc(srcFactor, dstFactor);
+	}
+
+	void bindFramebuffer(unsigned fbo) {
+		if(change(getState().fbo, fbo)) {
+			glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		}
+	}
+
+	unsigned getFramebuffer() {
+		auto& state = getState();
+		if(state.fbo == UNKNOWN) {
+			GLint fbo = 0;
+			glGetIntegerv(GL_FRAMEBUFFER_BINDING, &fbo);
+			state.fbo = unsigned(fbo);
+		}
+		return state.fbo;
+	}
+
+	bool isBlendEnabled() {
+		auto& state = getState();
+		if(state.blend < 0) {
+			state.blend = glIsEnabled(GL_BLEND) ? 1 : 0;
+		}
+		return state.blend != 0;
+	}
+
+	void deleteProgram(unsigned program) {
+		auto& state = getState();
+		if(state.program == program) {
+			state.program = UNKNOWN;
+		}
+		++state.frame.glCalls;
+		glDeleteProgram(program);
+	}
+
+	void deleteVertexArray(unsigned vao) {
+		auto& state = getState();
+		if(state.vao == vao) {
+			state.vao = UNKNOWN;
+		}
+		++state.frame.glCalls;
+		glDeleteVertexArrays(1, &vao);
+	}
+
+	void deleteTexture(unsigned texture) {
+		auto& state = getState();
+		for(auto& unit : state.textures) {
+			for(auto& bound : unit) {
+				if(bound == texture) {
+					bound = UNKNOWN;
+				}
+			}
+		}
+		++state.frame.glCalls;
+		glDeleteTextures(1, &texture);
+	}
+
+	void deleteFramebuffer(unsigned fbo) {
+		auto& state = getState();
+		if(state.fbo == fbo) {
+			state.fbo = UNKNOWN;
+		}
+		++state.frame.glCalls;
+		glDeleteFramebuffers(1, &fbo);
+	}
+
+	void countCalls(size_t numCalls) {
+		getState().frame.glCalls += numCalls;
+	}
+
+	void countDraw() {
+		auto& state = getState();
+		++state.frame.glCalls;
+		++state.frame.drawCalls;
+	}
+
+	void invalidate() {
+		getState().forget();
+	}
+
+	void nextFrame() {
+		auto& state = getState();
+		state.lastFrame = state.frame;
+		state.frame = Stats();
+		++state.frameNumber;
+	}
+
+	size_t getFrameNumber() {
+		return getState().frameNumber;
+	}
+
+	const Stats& getFrameStats() {
+		return getState().lastFrame;
+	}
+}
+}
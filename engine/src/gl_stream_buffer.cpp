@@ -0,0 +1,269 @@
+/*=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+ MIT License
+
+ Copyright (c) 2022 Mikko Romppainen (kajakbros@gmail.com)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
+#include <hungerland/stream_buffer.h>
+#include <hungerland/util.h>
+#include <hungerland/gl_utils.h>
+#include <hungerland/gl_state.h>
+#include <glad/gl.h>
+#include <GLFW/glfw3.h>
+#include <string.h>
+#include <assert.h>
+
+namespace hungerland {
+namespace graphics {
+	namespace {
+		// Buffer storage is GL 4.4 / ARB_buffer_storage, which is not part of the GL 3.3 loader
+		typedef void (GLAD_API_PTR *BufferStorageFunc)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+		const GLbitfield MAP_PERSISTENT_BIT = 0x0040;
+		const GLbitfield MAP_COHERENT_BIT = 0x0080;
+
+		// Loaded on first use, when the context is current
+		BufferStorageFunc getBufferStorage() {
+			static const BufferStorageFunc bufferStorage = []() -> BufferStorageFunc {
+				GLint major = 0;
+				GLint minor = 0;
+				glGetIntegerv(GL_MAJOR_VERSION, &major);
+				glGetIntegerv(GL_MINOR_VERSION, &minor);
+				const bool supported = major > 4 || (major == 4 && minor >= 4) || glfwExtensionSupported("GL_ARB_buffer_storage");
+				if(!supported) {
+					util::INFO("Buffer storage not supported, stream buffers are mapped per write");
+					return 0;
+				}
+				return (BufferStorageFunc)glfwGetProcAddress("glBufferStorage");
+			}();
+			return bufferStorage;
+		}
+
+		bool intersects(size_t begin0, size_t end0, size_t begin1, size_t end1) {
+			return begin0 < end1 && begin1 < end0;
+		}
+	}
+
+	StreamBuffer::StreamBuffer(size_t capacity)
+		: m_bufferId(0)
+		, m_capacity(capacity)
+		, m_head(0)
+		, m_frameBegin(0)
+		, m_frameNumber(glstate::getFrameNumber())
+		, m_frameWritten(false)
+		, m_frameWrapped(false)
+		, m_persistent(0)
+		, m_mapped(false) {
+		assert(capacity > 0);
+		glGenBuffers(1, &m_bufferId);
+		checkGLError();
+		glBindBuffer(GL_ARRAY_BUFFER, m_bufferId);
+		checkGLError();
+		auto bufferStorage = getBufferStorage();
+		if(bufferStorage != 0) {
+			const GLbitfield flags = GL_MAP_WRITE_BIT | MAP_PERSISTENT_BIT | MAP_COHERENT_BIT;
+			bufferStorage(GL_ARRAY_BUFFER, GLsizeiptr(m_capacity), 0, flags);
+			checkGLError();
+			m_persistent = static_cast<uint8_t*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, GLsizeiptr(m_capacity), flags));
+			checkGLError();
+			if(m_persistent == 0) {
+				// Storage of the buffer is immutable, so fall back to a new buffer
+				util::WARN("Persistent mapping of stream buffer failed, buffer is mapped per write");
+				glDeleteBuffers(1, &m_bufferId);
+				glGenBuffers(1, &m_bufferId);
+				glBindBuffer(GL_ARRAY_BUFFER, m_bufferId);
+				checkGLError();
+			}
+		}
+		if(m_persistent == 0) {
+			glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(m_capacity), 0, GL_STREAM_DRAW);
+			checkGLError();
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		checkGLError();
+	}
+
+	StreamBuffer::~StreamBuffer() {
+		for(const auto& fence : m_fences) {
+			glDeleteSync(static_cast<GLsync>(fence.sync));
+		}
+		// Deleting unmaps the persistent mapping
+		glDeleteBuffers(1, &m_bufferId);
+	}
+
+	void* StreamBuffer::map(size_t size, size_t& offset, size_t alignment) {
+		assert(!m_mapped);
+		assert(size > 0);
+		offset = reserve(size, alignment);
+		m_mapped = true;
+		if(m_persistent != 0) {
+			return m_persistent + offset;
+		}
+		// Fences guarantee, that the GPU does not read the range anymore
+		glBindBuffer(GL_ARRAY_BUFFER, m_bufferId);
+		checkGLError();
+		void* ptr = glMapBufferRange(GL_ARRAY_BUFFER, GLintptr(offset), GLsizeiptr(size),
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		glstate::countCalls(2);
+		checkGLError();
+		return ptr;
+	}
+
+	void StreamBuffer::unmap() {
+		assert(m_mapped);
+		m_mapped = false;
+		if(m_persistent != 0) {
+			return;
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, m_bufferId);
+		checkGLError();
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		glstate::countCalls(2);
+		checkGLError();
+	}
+
+	size_t StreamBuffer::write(const void* data, size_t size, size_t alignment) {
+		if(size == 0) {
+			return 0;
+		}
+		size_t offset = 0;
+		void* ptr = map(size, offset, alignment);
+		if(ptr != 0) {
+			memcpy(ptr, data, size);
+		}
+		unmap();
+		return offset;
+	}
+
+	void StreamBuffer::bind() const {
+		glBindBuffer(GL_ARRAY_BUFFER, m_bufferId);
+		glstate::countCalls();
+		checkGLError();
+	}
+
+	unsigned StreamBuffer::getId() const {
+		return m_bufferId;
+	}
+
+	size_t StreamBuffer::getCapacity() const {
+		return m_capacity;
+	}
+
+	bool StreamBuffer::isPersistent() const {
+		return m_persistent != 0;
+	}
+
+	size_t StreamBuffer::reserve(size_t size, size_t alignment) {
+		assert(size <= m_capacity);
+		beginFrame();
+		alignment = alignment > 0 ? alignment : 1;
+		size_t offset = (m_head + alignment - 1) / alignment * alignment;
+		const bool wrap = offset + size > m_capacity;
+		if(wrap) {
+			offset = 0;
+		}
+
+		// Data of the current frame is not fenced yet, so it may not be overwritten
+		const bool overflow = (m_frameWrapped && wrap) || ((m_frameWrapped || wrap) && offset + size > m_frameBegin);
+		if(overflow) {
+			if(m_persistent != 0) {
+				// Wait until the GPU has consumed everything written so far
+				m_fences.push_back({glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), m_frameBegin, m_head});
+				checkGLError();
+				while(!m_fences.empty()) {
+					waitOldest();
+				}
+				util::WARN("Stream buffer of " + std::to_string(m_capacity) + " bytes is too small for one frame, waiting for the GPU");
+			} else {
+				// Orphan: draws in flight keep the old storage
+				glBindBuffer(GL_ARRAY_BUFFER, m_bufferId);
+				glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(m_capacity), 0, GL_STREAM_DRAW);
+				glstate::countCalls(2);
+				checkGLError();
+				for(const auto& fence : m_fences) {
+					glDeleteSync(static_cast<GLsync>(fence.sync));
+				}
+				m_fences.clear();
+			}
+			m_frameBegin = offset;
+			m_frameWrapped = false;
+		} else {
+			// Wait for the youngest earlier frame, which has used the range. Older frames are complete then too.
+			size_t numComplete = 0;
+			for(size_t i = 0; i < m_fences.size(); ++i) {
+				const auto& fence = m_fences[i];
+				bool used = fence.end > fence.begin
+					? intersects(offset, offset + size, fence.begin, fence.end)
+					: (fence.end == fence.begin || intersects(offset, offset + size, fence.begin, m_capacity) || intersects(offset, offset + size, 0, fence.end));
+				if(used) {
+					numComplete = i + 1;
+				}
+			}
+			if(numComplete > 0) {
+				while(m_fences.size() > 1 && numComplete > 1) {
+					glDeleteSync(static_cast<GLsync>(m_fences.front().sync));
+					m_fences.pop_front();
+					--numComplete;
+				}
+				waitOldest();
+			}
+			if(wrap) {
+				m_frameWrapped = true;
+			}
+		}
+		m_head = offset + size;
+		return offset;
+	}
+
+	void StreamBuffer::beginFrame() {
+		const auto frameNumber = glstate::getFrameNumber();
+		if(frameNumber != m_frameNumber) {
+			// All draws of the previous frame have been issued, fence them
+			if(m_frameWritten) {
+				m_fences.push_back({glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), m_frameBegin, m_head});
+				glstate::countCalls();
+				checkGLError();
+			}
+			m_frameNumber = frameNumber;
+			m_frameWritten = false;
+			m_frameWrapped = false;
+		}
+		if(!m_frameWritten) {
+			m_frameBegin = m_head;
+			m_frameWritten = true;
+		}
+	}
+
+	void StreamBuffer::waitOldest() {
+		assert(!m_fences.empty());
+		auto sync = static_cast<GLsync>(m_fences.front().sync);
+		m_fences.pop_front();
+		GLenum result = GL_TIMEOUT_EXPIRED;
+		while(result == GL_TIMEOUT_EXPIRED) {
+			result = glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		}
+		if(result == GL_WAIT_FAILED) {
+			util::WARN("Waiting for stream buffer fence failed");
+		}
+		glDeleteSync(sync);
+		glstate::countCalls(2);
+		checkGLError();
+	}
+}
+}
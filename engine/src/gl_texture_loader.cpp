@@ -0,0 +1,195 @@
+/*=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+ MIT License
+
+ Copyright (c) 2022 Mikko Romppainen (kajakbros@gmail.com)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
+#include <hungerland/texture_loader.h>
+#include <hungerland/util.h>
+#include <hungerland/gl_utils.h>
+#include <hungerland/gl_state.h>
+#include <glad/gl.h>
+#include <algorithm>
+#include <string.h>
+
+namespace hungerland {
+namespace texture {
+
+	TextureLoader::TextureLoader(DecodeFunc decode, size_t numWorkers, size_t uploadBytesPerFrame)
+		: m_decode(decode)
+		, m_uploadBytesPerFrame(std::max<size_t>(uploadBytesPerFrame, 1))
+		, m_pbo(0)
+		, m_stopping(false) {
+		glGenBuffers(1, &m_pbo);
+		checkGLError();
+		for(size_t i = 0; i < std::max<size_t>(numWorkers, 1); ++i) {
+			m_workers.emplace_back(&TextureLoader::work, this);
+		}
+	}
+
+	TextureLoader::~TextureLoader() {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stopping = true;
+		}
+		m_workAvailable.notify_all();
+		for(auto& worker : m_workers) {
+			worker.join();
+		}
+		glDeleteBuffers(1, &m_pbo);
+	}
+
+	Texture::Ref TextureLoader::load(const std::string& filename) {
+		auto it = m_entries.find(filename);
+		if(it != m_entries.end()) {
+			return it->second.handle;
+		}
+		// Transparent placeholder, so that sprites of loading textures are not visible
+		static const uint8_t PLACEHOLDER[4] = {0, 0, 0, 0};
+		auto& entry = m_entries[filename];
+		entry.handle = std::make_shared<Texture>(1, 1, 4, PLACEHOLDER);
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_decodeQueue.push_back(filename);
+		}
+		m_workAvailable.notify_one();
+		return entry.handle;
+	}
+
+	bool TextureLoader::isResident(const std::string& filename) const {
+		auto it = m_entries.find(filename);
+		return it != m_entries.end() && it->second.state == State::RESIDENT;
+	}
+
+	void TextureLoader::update() {
+		// Take decoded images from workers
+		std::deque<std::pair<std::string, std::unique_ptr<DecodedImage> > > decoded;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			decoded.swap(m_decoded);
+		}
+		for(auto& image : decoded) {
+			auto& entry = m_entries[image.first];
+			if(image.second == 0) {
+				// Keep the transparent placeholder and continue with other images, since throwing here would lose them
+				entry.state = State::FAILED;
+				util::WARN("Failed to load texture: \"" + image.first + "\"!");
+				continue;
+			}
+			entry.state = State::UPLOADING;
+			m_uploads.push_back({image.first, std::move(*image.second), 0, 0});
+		}
+
+		// Upload in order until the budget of the frame is used
+		size_t budget = m_uploadBytesPerFrame;
+		while(!m_uploads.empty() && budget > 0) {
+			auto& upload = m_uploads.front();
+			if(!uploadRows(upload, budget)) {
+				break;
+			}
+			auto& entry = m_entries[upload.filename];
+			entry.handle->swap(*upload.texture);
+			entry.state = State::RESIDENT;
+			// Deletes the placeholder, which was swapped into the upload texture
+			m_uploads.pop_front();
+		}
+	}
+
+	size_t TextureLoader::getNumPending() const {
+		size_t numPending = 0;
+		for(const auto& entry : m_entries) {
+			if(entry.second.state == State::DECODING || entry.second.state == State::UPLOADING) {
+				++numPending;
+			}
+		}
+		return numPending;
+	}
+
+	void TextureLoader::work() {
+		for(;;) {
+			std::string filename;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_workAvailable.wait(lock, [this]() { return m_stopping || !m_decodeQueue.empty(); });
+				if(m_stopping) {
+					return;
+				}
+				filename = m_decodeQueue.front();
+				m_decodeQueue.pop_front();
+			}
+			auto image = std::make_unique<DecodedImage>();
+			bool ok = false;
+			try {
+				ok = m_decode(filename, *image);
+			} catch(const std::exception& e) {
+				util::WARN("Decoding \"" + filename + "\" failed: " + e.what());
+			}
+			if(!ok || image->width == 0 || image->height == 0 || image->pixels.size() != size_t(image->width) * image->height * 4) {
+				image.reset();
+			}
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_decoded.push_back({filename, std::move(image)});
+		}
+	}
+
+	bool TextureLoader::uploadRows(Upload& upload, size_t& budget) {
+		const auto& image = upload.image;
+		const size_t rowBytes = size_t(image.width) * 4;
+		size_t numRows = budget / rowBytes;
+		if(numRows == 0) {
+			if(budget < m_uploadBytesPerFrame) {
+				return false;
+			}
+			// Row larger than the whole budget: upload one row per frame
+			numRows = 1;
+		}
+		numRows = std::min<size_t>(numRows, image.height - upload.rowsUploaded);
+		if(upload.texture == 0) {
+			upload.texture = std::make_unique<Texture>(image.width, image.height, false);
+		}
+
+		// Copy rows to the PBO. It is orphaned, so the copy does not wait for the upload of the previous rows.
+		const size_t size = numRows * rowBytes;
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo);
+		checkGLError();
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, GLsizeiptr(size), 0, GL_STREAM_DRAW);
+		checkGLError();
+		void* ptr = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, GLsizeiptr(size), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		checkGLError();
+		if(ptr != 0) {
+			memcpy(ptr, &image.pixels[upload.rowsUploaded * rowBytes], size);
+		}
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		checkGLError();
+
+		// Texture reads the rows from the PBO asynchronously
+		glstate::bindTexture(GL_TEXTURE_2D, upload.texture->getId());
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, GLint(upload.rowsUploaded), GLsizei(image.width), GLsizei(numRows), GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+		checkGLError();
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		checkGLError();
+		glstate::countCalls(6);
+
+		upload.rowsUploaded += unsigned(numRows);
+		budget -= std::min(budget, size);
+		return upload.rowsUploaded == image.height;
+	}
+}
+}
@@ -0,0 +1,75 @@
+/*=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+ MIT License
+
+ Copyright (c) 2022 Mikko Romppainen (kajakbros@gmail.com)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
+#include <hungerland/uniform_buffer.h>
+#include <hungerland/gl_utils.h>
+#include <hungerland/gl_state.h>
+#include <glad/gl.h>
+#include <assert.h>
+
+namespace hungerland {
+namespace graphics {
+
+	UniformBuffer::UniformBuffer(size_t capacity)
+		: m_bufferId(0)
+		, m_capacity(capacity)
+		, m_offset(0)
+		, m_alignment(256) {
+		GLint alignment = 0;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		checkGLError();
+		if(alignment > 0) {
+			m_alignment = size_t(alignment);
+		}
+		glGenBuffers(1, &m_bufferId);
+		checkGLError();
+		glBindBuffer(GL_UNIFORM_BUFFER, m_bufferId);
+		glBufferData(GL_UNIFORM_BUFFER, m_capacity, 0, GL_STREAM_DRAW);
+		checkGLError();
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	UniformBuffer::~UniformBuffer() {
+		glDeleteBuffers(1, &m_bufferId);
+	}
+
+	void UniformBuffer::push(unsigned binding, const void* data, size_t size) {
+		assert(size <= m_capacity);
+		glBindBuffer(GL_UNIFORM_BUFFER, m_bufferId);
+		checkGLError();
+		if(m_offset + size > m_capacity) {
+			// Orphan: draws in flight keep the old storage
+			glBufferData(GL_UNIFORM_BUFFER, m_capacity, 0, GL_STREAM_DRAW);
+			checkGLError();
+			m_offset = 0;
+		}
+		glBufferSubData(GL_UNIFORM_BUFFER, m_offset, size, data);
+		checkGLError();
+		glBindBufferRange(GL_UNIFORM_BUFFER, binding, m_bufferId, m_offset, size);
+		checkGLError();
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		glstate::countCalls(4);
+		m_offset += (size + m_alignment - 1) / m_alignment * m_alignment;
+	}
+}
+}
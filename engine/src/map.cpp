@@ -22,16 +22,19 @@
  SOFTWARE.
 =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
 #include <hungerland/map.h>
+#include <hungerland/map_bake.h>
 #include <hungerland/shader.h>
 #include <hungerland/texture.h>
 #include <hungerland/mesh.h>
 #include <hungerland/util.h>
 #include <hungerland/gl_utils.h>
+#include <hungerland/gl_state.h>
 #include <hungerland/graphics.h>
+#include <hungerland/uniform_buffer.h>
 #include <glad/gl.h>
+#include <algorithm>
+#include <limits>
 
-#include <tmxlite/Map.hpp>
-#include <tmxlite/TileLayer.hpp>
 #include <tmxlite/Map.hpp>
 #include <tmxlite/TileLayer.hpp>
 #include <tmxlite/ImageLayer.hpp>
@@ -39,150 +42,281 @@
 namespace hungerland {
 namespace map {
 
-	template<typename Layer>
-	auto getLayerPixels(const Layer& layer, int firstGID, int tileCount){
-		const auto& layerSize =  layer.getSize();
-		const auto& layerTiles = layer.getTiles();
-		std::vector<float> layerPixels;
-		bool tsUsed = false;
-		for(auto ly = 0u; ly < layerSize.y; ++ly) {
-			for(auto lx = 0u; lx < layerSize.x; ++lx) {
-				int tileIndex = ly * layerSize.x + lx;
-				int layerTileID = layerTiles[tileIndex].ID;
-				//auto firstGID = tileSet.getFirstGID();
-				int lastGID = firstGID + tileCount - 1;
-				if(layerTileID >= firstGID && layerTileID <= lastGID) {
-					auto tileId = layerTileID - firstGID + 1;
-					// Red channel: making sure to index relative to the tileset
-					layerPixels.push_back(float(tileId));
-					// Green channel: tile flips are performed on the shader
-					layerPixels.push_back(float(layerTiles[tileIndex].flipFlags));
-					layerPixels.push_back(0);
-					layerPixels.push_back(0);
-					tsUsed = true;
-				} else {
-					// Pad with empty space
-					layerPixels.push_back(0);
-					layerPixels.push_back(0);
-					layerPixels.push_back(0);
-					layerPixels.push_back(0);
-				}
+	void fillLookup(uint32_t* lookup, const Grid<int>& tileIds, const Grid<uint8_t>& tileFlags, size2d_t origin, size2d_t size) {
+		for(auto ly = origin.y; ly < origin.y + size.y; ++ly) {
+			const int* ids = tileIds.getData() + ly*tileIds.getSize().x;
+			const uint8_t* flags = tileFlags.getData() + ly*tileFlags.getSize().x;
+			for(auto lx = origin.x; lx < origin.x + size.x; ++lx) {
+				// Tile flips are performed on the shader
+				*lookup++ = packTile(ids[lx], flags[lx]);
 			}
 		}
-		if(!tsUsed) layerPixels.clear();
-		return layerPixels;
 	}
 
-	/*auto getLayerPixels(const TileLayer& layer, int firstGID, int tileCount){
-		const auto& tileIds = layer.tileIds;
-		const auto& tileFlags = layer.tileFlags;
-		const auto& layerSize =  size2d_t{tileIds[0].size(),tileIds.size()};
-		std::vector<float> layerPixels;
-		layerPixels.resize(layerSize.x*layerSize.y*4);
-		bool tsUsed = false;
-
-		for(auto ly = 0u; ly < layerSize.y; ++ly) {
-			for(auto lx = 0u; lx < layerSize.x; ++lx) {
-				auto tileIndex = ly * layerSize.x + lx;
-				auto layerTileID = layerTiles[tileIndex].ID;
-
-
-				int i = ly * layer.tileIds[ly].size() + lx;
-				if(layerTileID >= firstGID && layerTileID <= (firstGID+tileCount)) {
-					// Red channel: making sure to index relative to the tileset
-					layerPixels[i+0] = float(layerTileID);
-					layerPixels[i+1] = float(layerTileFlags);
-					layerPixels[i+2] = 0.0f;
-					layerPixels[i+3] = 0.0f;
-					tsUsed = true;
-				} else {
-					// Pad with empty space
-					layerPixels[i+0] = 0.0f;
-					layerPixels[i+1] = 0.0f;
-					layerPixels[i+2] = 0.0f;
-					layerPixels[i+3] = 0.0f;
-				}
-			}
-		}
-
-		if(!tsUsed) layerPixels.clear();
-		return layerPixels;
-	}*/
-
-	template<typename Subsets, typename Layer, typename MapBounds, typename Tilesets, typename TilesetTextures>
-	auto createLayerSubsets(Subsets& subsets, const Layer& layer, const MapBounds& bounds, const Tilesets& tilesets, const TilesetTextures& tilesetTextures) {
+	template<typename Subsets, typename Layer, typename Tilesets, typename TilesetTextures>
+	auto createLayerSubsets(Subsets& subsets, const Layer& layer, const Tilesets& tilesets, const TilesetTextures& tilesetTextures) {
 		subsets.clear();
 		for(auto tilesetId = 0u; tilesetId < tilesets.size(); ++tilesetId) {
-			// Check each tile ID to see if it falls in the current tile set
 			const auto& ts = tilesets[tilesetId];
 			TileSetSubset subset;
 			assert(tilesetId < tilesetTextures.size());
-			subset.mesh			= quad::createImage(bounds.left, bounds.top, bounds.width, bounds.height);
 			subset.used			= false;
-			subset.opacity		= layer.getOpacity();
-			subset.offset.x		= layer.getOffset().x;
-			subset.offset.y		= layer.getOffset().y;
+			subset.opacity		= layer.opacity;
+			subset.offset		= layer.offset;
 			subset.tileMap		= tilesetTextures[tilesetId];
-			subset.tileSize.x	= ts.getTileSize().x;
-			subset.tileSize.y	= ts.getTileSize().y;
-			subset.tilesetSize.x= ts.getColumnCount();
-			subset.tilesetSize.y= ts.getTileCount()/ts.getColumnCount();
+			subset.tileSize		= ts.tileSize;
+			subset.tilesetSize	= ts.tilesetSize;
+			subset.firstGID		= ts.firstGID;
+			subset.tileCount	= ts.tileCount;
 			subsets.push_back(subset);
 		}
 	};
 
-	template<typename Subset, typename Size2d, typename Pixels>
-	void setColorLookup(Subset& subset, const Size2d layerSize, const Pixels& layerPixels) {
-		if(layerPixels.size()>0) {
-			subset.used = true;
-			if(subset.colorLookup == 0) {
-				subset.colorLookup	= std::make_shared<texture::Texture>(layerSize.x, layerSize.y, 4, &layerPixels[0]);
-			} else {
-				subset.colorLookup->setData(layerSize.x, layerSize.y, 4, &layerPixels[0]);
+
+	/// TileLayer
+	TileLayer::TileLayer(const MapData& map, size_t layerIndex, const Textures& tilesetTextures, size_t chunkSize)
+		: chunkSize(chunkSize)
+		, numChunks{0,0}
+		, m_classesByTileId(map.classesByTileId) {
+		const auto& layer = map.tileLayers[layerIndex];
+		util::INFO("Creating map layer: index="+std::to_string(layerIndex)+", type=TileLayer, Name=\"" + layer.name + "\"");
+		textures = tilesetTextures;
+		m_boundsOrigin = glm::vec2(map.bounds.x, map.bounds.y);
+		m_tileSizePixels = map.tileSize;
+		createLayerSubsets(subsets, layer, map.tilesets, textures);
+		for(auto i = 0u; i < subsets.size(); ++i) {
+			const auto& subset = subsets[i];
+			if(m_subsetByGid.size() < size_t(subset.firstGID + subset.tileCount)) {
+				m_subsetByGid.resize(subset.firstGID + subset.tileCount, -1);
 			}
-		} else {
-			subset.used = false;
-			subset.colorLookup	= 0;
+			std::fill_n(m_subsetByGid.begin() + subset.firstGID, subset.tileCount, int(i));
+		}
+
+		m_size = layer.size;
+		m_chunkExtent = chunkSize > 0 ? chunkSize : std::max(size_t(1), std::max(m_size.x, m_size.y));
+		numChunks = {(m_size.x + m_chunkExtent - 1) / m_chunkExtent, (m_size.y + m_chunkExtent - 1) / m_chunkExtent};
+		if(chunkSize == 0) {
+			createChunk(0, 0);
+		}
+
+		// Copy tiles of map chunks to layer chunks. Layer chunks without tiles are not created.
+		const auto cs = m_chunkExtent;
+		for(const auto& src : layer.chunks) {
+			const auto* tiles = src.getTiles();
+			const size_t srcX1 = std::min(src.origin.x + src.size.x, m_size.x);
+			const size_t srcY1 = std::min(src.origin.y + src.size.y, m_size.y);
+			assert(srcX1 == src.origin.x + src.size.x && srcY1 == src.origin.y + src.size.y);
+			if(src.origin.x >= srcX1 || src.origin.y >= srcY1) {
+				continue;
+			}
+			for(auto cy = src.origin.y / cs; cy <= (srcY1 - 1) / cs; ++cy) {
+				for(auto cx = src.origin.x / cs; cx <= (srcX1 - 1) / cs; ++cx) {
+					const size_t x0 = std::max(src.origin.x, cx * cs);
+					const size_t y0 = std::max(src.origin.y, cy * cs);
+					const size_t x1 = std::min(srcX1, (cx + 1) * cs);
+					const size_t y1 = std::min(srcY1, (cy + 1) * cs);
+					auto row = [&](size_t y) {
+						return tiles + (y - src.origin.y)*src.size.x + (x0 - src.origin.x);
+					};
+					auto it = m_chunkIndices.find(cy*numChunks.x + cx);
+					size_t chunkIndex = 0;
+					if(it != m_chunkIndices.end()) {
+						chunkIndex = it->second;
+					} else {
+						bool hasTiles = false;
+						for(auto y = y0; y < y1 && !hasTiles; ++y) {
+							hasTiles = std::any_of(row(y), row(y) + (x1 - x0), [](uint32_t tile) { return tile != 0; });
+						}
+						if(!hasTiles) {
+							continue;
+						}
+						chunkIndex = createChunk(cx, cy);
+					}
+					auto& chunk = chunks[chunkIndex];
+					for(auto y = y0; y < y1; ++y) {
+						std::copy(row(y), row(y) + (x1 - x0), chunk.packedTiles.begin() + (y - chunk.origin.y)*chunk.size.x + (x0 - chunk.origin.x));
+						if(chunkSize == 0) {
+							// Create objects from non zero tile ids:
+							for(auto x = x0; x < x1; ++x) {
+								const auto tileId = size_t(row(y)[x - x0] & LOOKUP_ID_MASK);
+								if(tileId > 0) {
+									objects.push_back({{x,y}, tileId});
+								}
+							}
+						}
+					}
+				}
+			}
+		}
+
+		if(chunkSize == 0) {
+			// Non chunked layer is always resident
+			setChunkResident(0, true);
 		}
 	}
 
+	size_t TileLayer::createChunk(size_t cx, size_t cy) {
+		const auto cs = m_chunkExtent;
+		TileChunk chunk;
+		chunk.origin = {cx * cs, cy * cs};
+		chunk.size = {std::min(cs, m_size.x - chunk.origin.x), std::min(cs, m_size.y - chunk.origin.y)};
+		chunk.packedTiles.assign(chunk.size.x*chunk.size.y, 0);
+		m_chunkIndices[cy*numChunks.x + cx] = chunks.size();
+		chunks.push_back(std::move(chunk));
+		return chunks.size() - 1;
+	}
 
-	/// TileLayer
-	TileLayer::TileLayer(const tmx::Map& map, size_t layerIndex, const Textures& tilesetTextures) {
-		const tmx::TileLayer& layer = *dynamic_cast<tmx::TileLayer*>(map.getLayers()[layerIndex].get());
-		util::INFO("Creating map layer: index="+std::to_string(layerIndex)+", type=TileLayer, Name=\"" + layer.getName() + "\"");
-		const auto& layerSize =  layer.getSize();
-		const auto& layerTiles = layer.getTiles();
-		textures = tilesetTextures;
+	const TileChunk* TileLayer::findChunk(size_t x, size_t y) const {
+		if(x >= m_size.x || y >= m_size.y) {
+			return 0;
+		}
+		if(chunkSize == 0) {
+			return &chunks[0];
+		}
+		auto it = m_chunkIndices.find((y / chunkSize)*numChunks.x + x / chunkSize);
+		return it != m_chunkIndices.end() ? &chunks[it->second] : 0;
+	}
+
+	int TileLayer::getTileId(size_t x, size_t y) const {
+		if(x >= m_size.x || y >= m_size.y) {
+			return -1;
+		}
+		auto chunk = findChunk(x, y);
+		return chunk != 0 ? chunk->getTileId(x, y) : 0;
+	}
+
+	bool TileLayer::isSolid(size_t x, size_t y) const {
+		auto chunk = findChunk(x, y);
+		return chunk != 0 && chunk->isSolid(x, y);
+	}
 
-		tileIds = util::gridNM(layer.getSize().x,layer.getSize().y, 0);
-		tileFlags = util::gridNM(layer.getSize().x,layer.getSize().y, 0);
-		// Create objects from non zero tile ids:
-		for(auto ly = 0u; ly < layerSize.y; ++ly) {
-			for(auto lx = 0u; lx < layerSize.x; ++lx) {
-				auto tileIndex = ly * layerSize.x + lx;
-				auto layerTile = layerTiles[tileIndex];
-				if(layerTile.ID > 0) {
-					//tileIds[layerSize.y-ly-1][lx] = layerTile.ID;
-					//tileFlags[tileIds.size()-ly-1][lx] = layerTile.flipFlags;
-					//objects.push_back({lx,layerSize.y-ly-1});
-					tileIds[ly][lx] = layerTile.ID;
-					tileFlags[ly][lx] = layerTile.flipFlags;
-					objects.push_back({{lx,ly}, layerTile.ID});
+	bool TileLayer::isAnySolid(size_t x0, size_t y0, size_t x1, size_t y1) const {
+		if(x0 > x1 || y0 > y1 || x0 >= m_size.x || y0 >= m_size.y) {
+			return false;
+		}
+		x1 = std::min(x1, m_size.x-1);
+		y1 = std::min(y1, m_size.y-1);
+		const auto cs = m_chunkExtent;
+		for(auto cy = y0 / cs; cy <= y1 / cs; ++cy) {
+			for(auto cx = x0 / cs; cx <= x1 / cs; ++cx) {
+				auto chunk = findChunk(std::max(x0, cx * cs), std::max(y0, cy * cs));
+				if(chunk == 0) {
+					continue;
+				}
+				const auto& o = chunk->origin;
+				const size_t lx0 = std::max(x0, o.x) - o.x;
+				const size_t ly0 = std::max(y0, o.y) - o.y;
+				const size_t lx1 = std::min(x1, o.x + chunk->size.x - 1) - o.x;
+				const size_t ly1 = std::min(y1, o.y + chunk->size.y - 1) - o.y;
+				if(chunk->resident) {
+					if(chunk->solidTiles.any(lx0, ly0, lx1, ly1)) {
+						return true;
+					}
+					continue;
+				}
+				for(auto ly = ly0; ly <= ly1; ++ly) {
+					const uint32_t* row = chunk->packedTiles.data() + ly*chunk->size.x;
+					if(std::any_of(row + lx0, row + lx1 + 1, [](uint32_t tile) { return (tile & LOOKUP_ID_MASK) != 0; })) {
+						return true;
+					}
 				}
 			}
 		}
-		/*util::INFO("Layer index=" + std::to_string(layerIndex) + " has " + std::to_string(objects.size()) + " objects");
-		for(const auto& o : objects){
-			util::INFO("x=" + std::to_string(o.x) + "y=" + std::to_string(o.y));
-		}*/
+		return false;
+	}
 
-		createLayerSubsets(subsets, layer, map.getBounds(), map.getTilesets(), textures);
-		for(auto layerId = 0u; layerId < subsets.size(); ++layerId) {
-			auto ts = map.getTilesets()[layerId];
-			std::vector<float> layerPixels = getLayerPixels(layer, ts.getFirstGID(), ts.getTileCount());
-			setColorLookup(subsets[layerId], layer.getSize(), layerPixels);
+	uint32_t TileLayer::getTileClasses(size_t x, size_t y) const {
+		auto chunk = findChunk(x, y);
+		if(chunk == 0) {
+			return 0;
+		}
+		if(chunk->resident) {
+			return chunk->tileClasses.get(x - chunk->origin.x, y - chunk->origin.y);
 		}
+		return getClassBits(chunk->getTileId(x, y));
+	}
+
+	TileClassBits TileLayer::getClassBits(int tileId) const {
+		const auto classIndex = size_t(tileId);
+		return (tileId > 0 && classIndex < m_classesByTileId.size()) ? TileClassBits(m_classesByTileId[classIndex]) : 0;
+	}
+
+	void TileLayer::markUsedSubsets(TileChunk& chunk) const {
+		for(auto& subset : chunk.subsets) {
+			subset.used = false;
+		}
+		const auto size = chunk.tileIds.getSize();
+		for(auto ly = 0u; ly < size.y; ++ly) {
+			for(auto lx = 0u; lx < size.x; ++lx) {
+				auto subsetIndex = findSubset(chunk.tileIds.get(lx, ly));
+				if(subsetIndex >= 0) {
+					chunk.subsets[subsetIndex].used = true;
+				}
+			}
+		}
+	}
+
+	void TileLayer::setChunkResident(size_t chunkIndex, bool resident) {
+		assert(chunkIndex < chunks.size());
+		auto& chunk = chunks[chunkIndex];
+		if(chunk.resident == resident) {
+			return;
+		}
+		chunk.subsets.clear();
+		chunk.lookup = 0;
+		chunk.dirtyRects.clear();
+		if(!resident) {
+			// Pack tiles and release grids
+			chunk.packedTiles.resize(chunk.size.x*chunk.size.y);
+			fillLookup(chunk.packedTiles.data(), chunk.tileIds, chunk.tileFlags, {0,0}, chunk.size);
+			chunk.tileIds = Grid<int>();
+			chunk.tileFlags = Grid<uint8_t>();
+			chunk.tileClasses = Grid<TileClassBits>();
+			chunk.solidTiles = BitGrid();
+			chunk.resident = false;
+			return;
+		}
+		// Unpack tiles to grids
+		chunk.resident = true;
+		chunk.tileIds.resize(chunk.size, 0);
+		chunk.tileFlags.resize(chunk.size, 0);
+		chunk.tileClasses.resize(chunk.size, 0);
+		chunk.solidTiles.resize(chunk.size);
+		for(auto ly = 0u; ly < chunk.size.y; ++ly) {
+			for(auto lx = 0u; lx < chunk.size.x; ++lx) {
+				const auto tile = chunk.packedTiles[ly*chunk.size.x + lx];
+				if(tile != 0) {
+					setChunkTile(chunk, lx, ly, int(tile & LOOKUP_ID_MASK), int(tile >> LOOKUP_FLIP_SHIFT));
+				}
+			}
+		}
+		const float x = m_boundsOrigin.x + float(chunk.origin.x * m_tileSizePixels.x);
+		const float y = m_boundsOrigin.y + float(chunk.origin.y * m_tileSizePixels.y);
+		const float w = float(chunk.size.x * m_tileSizePixels.x);
+		const float h = float(chunk.size.y * m_tileSizePixels.y);
+		// Packed tiles are lookup texels
+		chunk.lookup = std::make_shared<texture::Texture>(chunk.size.x, chunk.size.y, 1, chunk.packedTiles.data());
+		std::vector<uint32_t>().swap(chunk.packedTiles);
+		// Chunk subsets have same indices as layer subsets
+		auto chunkMesh = quad::createImage(x, y, w, h);
+		chunk.subsets = subsets;
+		for(auto& subset : chunk.subsets) {
+			subset.mesh = chunkMesh;
+			subset.rect = glm::vec4(x, y, w, h);
+			subset.colorLookup = chunk.lookup;
+		}
+		markUsedSubsets(chunk);
+	}
+
+	void TileLayer::setChunkTile(TileChunk& chunk, size_t lx, size_t ly, int tileId, int flipFlags) {
+		if(!chunk.resident) {
+			chunk.packedTiles[ly*chunk.size.x + lx] = packTile(tileId, flipFlags);
+			return;
+		}
+		chunk.tileIds.set(lx, ly, tileId);
+		chunk.tileFlags.set(lx, ly, uint8_t(flipFlags));
+		chunk.tileClasses.set(lx, ly, getClassBits(tileId));
+		chunk.solidTiles.set(lx, ly, tileId > 0);
 	}
 
 	void TileLayer::setObjects(const Objects& objs) {
@@ -191,143 +325,508 @@ namespace map {
 			auto x = obj.first.x;
 			auto y = obj.first.y;
 			auto tileId = int(obj.second);
-			tileIds[y][x] = tileId;
-			//const auto& layerTiles = layer.getTiles()[;
+			if(x >= m_size.x || y >= m_size.y) {
+				continue;
+			}
+			const auto cx = x / m_chunkExtent;
+			const auto cy = y / m_chunkExtent;
+			auto it = m_chunkIndices.find(cy*numChunks.x + cx);
+			auto& chunk = chunks[it != m_chunkIndices.end() ? it->second : createChunk(cx, cy)];
+			const auto lx = x - chunk.origin.x;
+			const auto ly = y - chunk.origin.y;
+			// Flip flags of the tile are kept
+			const int flipFlags = chunk.resident ? chunk.tileFlags.get(lx, ly) : int(chunk.packedTiles[ly*chunk.size.x + lx] >> LOOKUP_FLIP_SHIFT);
+			setChunkTile(chunk, lx, ly, tileId, flipFlags);
 		}
-		for(auto layerIndex = 0u; layerIndex < subsets.size(); ++layerIndex) {
-/*			const tmx::TileLayer& layer = *dynamic_cast<tmx::TileLayer*>(map.getLayers()[layerIndex].get());
-			auto ts = map.getTilesets()[layerIndex];
-			std::vector<float> layerPixels = getLayerPixels(layer, ts.getFirstGID(), ts.getTileCount());
-			setColorLookup(subsets[layerIndex], layer.getSize(), layerPixels);*/
+		// Upload whole lookups of resident chunks
+		for(auto& chunk : chunks) {
+			if(chunk.resident) {
+				chunk.dirtyRects.assign(1, {0, 0, chunk.size.x - 1, chunk.size.y - 1});
+				markUsedSubsets(chunk);
+			}
 		}
 	}
 
+	int TileLayer::findSubset(int tileId) const {
+		return (tileId > 0 && size_t(tileId) < m_subsetByGid.size()) ? m_subsetByGid[tileId] : -1;
+	}
+
+	static void addDirtyRect(std::vector<DirtyRect>& rects, const DirtyRect& rect) {
+		static const size_t MAX_DIRTY_RECTS = 8;
+		// Merge with overlapping or adjacent rectangle
+		for(auto& r : rects) {
+			if(rect.x0 <= r.x1+1 && r.x0 <= rect.x1+1 && rect.y0 <= r.y1+1 && r.y0 <= rect.y1+1) {
+				r = {std::min(r.x0, rect.x0), std::min(r.y0, rect.y0), std::max(r.x1, rect.x1), std::max(r.y1, rect.y1)};
+				return;
+			}
+		}
+		rects.push_back(rect);
+		if(rects.size() > MAX_DIRTY_RECTS) {
+			// Too many small uploads: upload bounding rectangle instead
+			auto bounds = rects[0];
+			for(const auto& r : rects) {
+				bounds = {std::min(bounds.x0, r.x0), std::min(bounds.y0, r.y0), std::max(bounds.x1, r.x1), std::max(bounds.y1, r.y1)};
+			}
+			rects.assign(1, bounds);
+		}
+	}
+
+	void TileLayer::setTile(size_t x, size_t y, int tileId, int flipFlags) {
+		fillRect(x, y, 1, 1, tileId, flipFlags);
+	}
+
+	void TileLayer::fillRect(size_t x, size_t y, size_t width, size_t height, int tileId, int flipFlags) {
+		if(width == 0 || height == 0 || x >= m_size.x || y >= m_size.y) {
+			return;
+		}
+		const DirtyRect rect = {x, y, std::min(x + width, m_size.x) - 1, std::min(y + height, m_size.y) - 1};
+		if(tileId <= 0) {
+			flipFlags = 0;
+		}
+		// Replaced tiles are cleared by the lookup upload. Subset of the new tile must be drawn.
+		const auto newSubset = findSubset(tileId);
+		const auto cs = m_chunkExtent;
+		for(auto cy = rect.y0/cs; cy <= rect.y1/cs; ++cy) {
+			for(auto cx = rect.x0/cs; cx <= rect.x1/cs; ++cx) {
+				auto it = m_chunkIndices.find(cy*numChunks.x + cx);
+				size_t chunkIndex = 0;
+				if(it != m_chunkIndices.end()) {
+					chunkIndex = it->second;
+				} else if(tileId > 0) {
+					chunkIndex = createChunk(cx, cy);
+				} else {
+					// Tiles without chunk are already empty
+					continue;
+				}
+				auto& chunk = chunks[chunkIndex];
+				const auto& o = chunk.origin;
+				const DirtyRect local = {
+					std::max(rect.x0, o.x) - o.x,
+					std::max(rect.y0, o.y) - o.y,
+					std::min(rect.x1, o.x + chunk.size.x - 1) - o.x,
+					std::min(rect.y1, o.y + chunk.size.y - 1) - o.y
+				};
+				for(auto ly = local.y0; ly <= local.y1; ++ly) {
+					for(auto lx = local.x0; lx <= local.x1; ++lx) {
+						setChunkTile(chunk, lx, ly, tileId, flipFlags);
+					}
+				}
+				if(!chunk.resident) {
+					// Lookups are created from packed tiles when chunk becomes resident
+					continue;
+				}
+				addDirtyRect(chunk.dirtyRects, local);
+				if(newSubset >= 0) {
+					chunk.subsets[newSubset].used = true;
+				}
+			}
+		}
+	}
+
+	void TileLayer::uploadDirtyRects(TileChunk& chunk) {
+		for(const auto& r : chunk.dirtyRects) {
+			const size2d_t size = {r.x1 - r.x0 + 1, r.y1 - r.y0 + 1};
+			m_uploadBuffer.resize(size.x*size.y);
+			fillLookup(m_uploadBuffer.data(), chunk.tileIds, chunk.tileFlags, {r.x0, r.y0}, size);
+			chunk.lookup->setSubData(unsigned(r.x0), unsigned(r.y0), unsigned(size.x), unsigned(size.y), 1, m_uploadBuffer.data());
+		}
+		chunk.dirtyRects.clear();
+	}
+
+	void TileLayer::flush() {
+		for(auto& chunk : chunks) {
+			if(chunk.resident && chunk.dirtyRects.size() > 0) {
+				uploadDirtyRects(chunk);
+			}
+		}
+	}
+
+	/// BitGrid
+	void BitGrid::resize(size2d_t size) {
+		m_size = size;
+		m_stride = (size.x + WORD_BITS - 1) / WORD_BITS;
+		m_words.assign(m_stride*size.y, 0);
+	}
+
+	void BitGrid::set(size_t x, size_t y, bool value) {
+		auto& word = m_words[y*m_stride + x/WORD_BITS];
+		const Word bit = Word(1) << (x%WORD_BITS);
+		if(value) {
+			word |= bit;
+		} else {
+			word &= ~bit;
+		}
+	}
+
+	bool BitGrid::any(size_t x0, size_t y0, size_t x1, size_t y1) const {
+		if(m_size.x == 0 || m_size.y == 0 || x0 > x1 || y0 > y1 || x0 >= m_size.x || y0 >= m_size.y) {
+			return false;
+		}
+		x1 = std::min(x1, m_size.x-1);
+		y1 = std::min(y1, m_size.y-1);
+		const size_t w0 = x0 / WORD_BITS;
+		const size_t w1 = x1 / WORD_BITS;
+		// Masks for first and last word of the row span
+		const Word firstMask = ~Word(0) << (x0 % WORD_BITS);
+		const Word lastMask = ~Word(0) >> (WORD_BITS - 1 - (x1 % WORD_BITS));
+		for(size_t y = y0; y <= y1; ++y) {
+			const Word* row = &m_words[y*m_stride];
+			if(w0 == w1) {
+				if(row[w0] & firstMask & lastMask) return true;
+				continue;
+			}
+			if(row[w0] & firstMask) return true;
+			for(size_t w = w0+1; w < w1; ++w) {
+				if(row[w]) return true;
+			}
+			if(row[w1] & lastMask) return true;
+		}
+		return false;
+	}
+
 	/// ImageLayer
-	ImageLayer::ImageLayer(const tmx::Map& map, size_t layerIndex, const std::vector< std::shared_ptr<texture::Texture> >& imageTextures) {
-		const tmx::ImageLayer& layer = *dynamic_cast<tmx::ImageLayer*>(map.getLayers()[layerIndex].get());
-		util::INFO("Creating map layer: index="+std::to_string(layerIndex)+", type=ImageLayer, Name=\"" + layer.getName() + "\"");
+	ImageLayer::ImageLayer(const MapData& map, size_t layerIndex, std::shared_ptr<texture::Texture> texture) {
+		const auto& layer = map.imageLayers[layerIndex];
+		util::INFO("Creating map layer: index="+std::to_string(layerIndex)+", type=ImageLayer, Name=\"" + layer.name + "\"");
 		subset.used = true;
-		subset.opacity = layer.getOpacity();
-		subset.texture = imageTextures[layerIndex];
-		subset.offset.x = layer.getOffset().x;
-		subset.offset.y = layer.getOffset().y;
-		subset.repeat.x = layer.getRepeat().x;
-		subset.repeat.y = layer.getRepeat().y;
-		subset.parallaxFactor.x = layer.getParallax().x;
-		subset.parallaxFactor.y = layer.getParallax().y;
-		if(layer.hasTransparency()) {
-			subset.transparentColor.push_back(layer.getTransparencyColour().r);
-			subset.transparentColor.push_back(layer.getTransparencyColour().g);
-			subset.transparentColor.push_back(layer.getTransparencyColour().b);
-			subset.transparentColor.push_back(layer.getTransparencyColour().a);
-		}
+		subset.opacity = layer.opacity;
+		subset.texture = texture;
+		subset.offset = layer.offset;
+		subset.repeat = layer.repeat;
+		subset.parallaxFactor = layer.parallaxFactor;
+		subset.transparentColor = layer.transparentColor;
 		// Create mesh
-		auto texture = imageTextures[layerIndex];
-		auto bounds = map.getBounds();
-		float texScaleX = float(bounds.width)/float(subset.texture->getWidth());
-		float texScaleY = float(bounds.height)/float(subset.texture->getHeight());
-		subset.mesh = quad::createImage(bounds.left, bounds.top, bounds.width, bounds.height, texScaleX, texScaleY);
+		const auto& bounds = map.bounds;
+		float texScaleX = float(bounds.z)/float(subset.texture->getWidth());
+		float texScaleY = float(bounds.w)/float(subset.texture->getHeight());
+		subset.mesh = quad::createImage(bounds.x, bounds.y, bounds.z, bounds.w, texScaleX, texScaleY);
+		subset.rect = bounds;
+		subset.texScale = glm::vec2(texScaleX, texScaleY);
 	}
 
-	/// Map
-	Map::Map(const std::string& mapFilename, LoadTextureFuncType loadTexture)
-		: m_clearColor(0.5,0.5,0.5,1)
-		, m_map(std::make_shared<tmx::Map>())
-		, m_tileLayerShader(shaders::createTileLayer())
-		, m_imageLayerShader(shaders::createImageLayer())	{
-		// Load map
-		if(false == m_map->load(mapFilename)) {
+	/// MapData
+	MapData loadTmx(const std::string& mapFilename) {
+		tmx::Map map;
+		if(false == map.load(mapFilename)) {
 			util::ERR("Failed to load map file: \"" + mapFilename + "\"!");
 		}
 		util::INFO("Loaded Tiled map: " + mapFilename);
 
-		m_clearColor.r = m_map->getBackgroundColour().r/255.0f;
-		m_clearColor.g = m_map->getBackgroundColour().g/255.0f;
-		m_clearColor.b = m_map->getBackgroundColour().b/255.0f;
-		m_clearColor.a = m_map->getBackgroundColour().a/255.0f;
-		// Create tileset textures from map tilesets:
-		for(const auto& ts : m_map->getTilesets()) {
-			auto texture = loadTexture(ts.getImagePath());
-			if(texture == 0) {
-				util::ERR("Failed to load tileset texture file: \"" + ts.getImagePath() + "\"!");
+		MapData res;
+		res.mapSize = {map.getTileCount().x, map.getTileCount().y};
+		res.tileSize = {map.getTileSize().x, map.getTileSize().y};
+		const auto bounds = map.getBounds();
+		res.bounds = glm::vec4(bounds.left, bounds.top, bounds.width, bounds.height);
+		res.clearColor.r = map.getBackgroundColour().r/255.0f;
+		res.clearColor.g = map.getBackgroundColour().g/255.0f;
+		res.clearColor.b = map.getBackgroundColour().b/255.0f;
+		res.clearColor.a = map.getBackgroundColour().a/255.0f;
+		res.infinite = map.isInfinite();
+
+		for(const auto& ts : map.getTilesets()) {
+			TilesetData tileset;
+			tileset.imagePath = ts.getImagePath();
+			tileset.tileSize = {ts.getTileSize().x, ts.getTileSize().y};
+			tileset.tilesetSize = {ts.getColumnCount(), ts.getTileCount()/ts.getColumnCount()};
+			tileset.firstGID = int(ts.getFirstGID());
+			tileset.tileCount = int(ts.getTileCount());
+			res.tilesets.push_back(tileset);
+		}
+
+		// Create tile class bits from tileset tile classes and boolean tile properties:
+		auto getClassBit = [&res](const std::string& name) -> uint32_t {
+			auto it = res.tileClassBits.find(name);
+			if(it != res.tileClassBits.end()) {
+				return uint32_t(1) << it->second;
+			}
+			if(res.tileClassBits.size() >= MAX_TILE_CLASSES) {
+				util::WARN("Too many tile classes in map, ignoring class: \"" + name + "\"");
+				return 0;
+			}
+			auto bit = res.tileClassBits.size();
+			res.tileClassBits[name] = bit;
+			return uint32_t(1) << bit;
+		};
+		for(const auto& ts : map.getTilesets()) {
+			for(const auto& tile : ts.getTiles()) {
+				auto gid = size_t(ts.getFirstGID() + tile.ID);
+				uint32_t bits = 0;
+				if(tile.Class.size() > 0) {
+					bits |= getClassBit(tile.Class);
+				}
+				for(const auto& prop : tile.properties) {
+					if(prop.getType() == tmx::Property::Type::Boolean && prop.getBoolValue()) {
+						bits |= getClassBit(prop.getName());
+					}
+				}
+				if(bits != 0) {
+					if(res.classesByTileId.size() <= gid) {
+						res.classesByTileId.resize(gid+1, 0);
+					}
+					res.classesByTileId[gid] = bits;
+				}
 			}
-			util::INFO("Loaded tileset texture: " + ts.getImagePath());
-			m_tilesetTextures.push_back(texture);
 		}
 
-		// Create all rest textures for each layers:
-		const auto& layers = m_map->getLayers();
+		const auto& layers = map.getLayers();
+		if(res.infinite) {
+			// Chunks of infinite maps can be at negative coordinates and outside of the declared map size,
+			// so tile coordinates cover bounding rectangle of all chunks and the declared size. Only tiles of
+			// the chunks are stored.
+			int2d_t minTile = {0, 0};
+			int2d_t maxTile = {int(res.mapSize.x), int(res.mapSize.y)};
+			for(const auto& layer : layers) {
+				if(layer->getType() != tmx::Layer::Type::Tile) {
+					continue;
+				}
+				for(const auto& chunk : dynamic_cast<const tmx::TileLayer*>(layer.get())->getChunks()) {
+					minTile = {std::min(minTile.x, chunk.position.x), std::min(minTile.y, chunk.position.y)};
+					maxTile = {std::max(maxTile.x, chunk.position.x + chunk.size.x), std::max(maxTile.y, chunk.position.y + chunk.size.y)};
+				}
+			}
+			res.tileOrigin = minTile;
+			res.mapSize = {size_t(maxTile.x - minTile.x), size_t(maxTile.y - minTile.y)};
+			res.bounds = glm::vec4(float(minTile.x * int(res.tileSize.x)), float(minTile.y * int(res.tileSize.y)),
+				float(res.mapSize.x * res.tileSize.x), float(res.mapSize.y * res.tileSize.y));
+		}
 		for(auto layerIndex = 0u; layerIndex < layers.size(); ++layerIndex) {
 			const auto layerType = layers[layerIndex]->getType();
+			const auto& layerName = layers[layerIndex]->getName();
 			if(layerType == tmx::Layer::Type::Tile) {
-			} else if(layerType == tmx::Layer::Type::Group) {
-				util::INFO("Creating map layer: index="+std::to_string(layerIndex)+", type=Group, Name=\"" + m_map->getLayers()[layerIndex]->getName() + "\"");
-				util::WARN("Group layers are not supported in tmx-maps");
-			} else if(layerType == tmx::Layer::Type::Image) {
-				const tmx::ImageLayer& layer = *dynamic_cast<tmx::ImageLayer*>(m_map->getLayers()[layerIndex].get());
-				auto imgPath = layer.getImagePath();
-				if(imgPath.size() > 0) {
-					auto texture = loadTexture(imgPath);
-					texture->setRepeat(true);
-					if(texture == 0) {
-						util::ERR("Failed to load image texture file: \"" + imgPath + "\"!");
+				const tmx::TileLayer& layer = *dynamic_cast<tmx::TileLayer*>(layers[layerIndex].get());
+				TileLayerData data;
+				data.name = layerName;
+				data.opacity = layer.getOpacity();
+				data.offset = {layer.getOffset().x, layer.getOffset().y};
+				data.size = res.infinite ? res.mapSize : size2d_t{layer.getSize().x, layer.getSize().y};
+				auto addChunk = [&data](size2d_t origin, size2d_t size, const std::vector<tmx::TileLayer::Tile>& tiles) {
+					if(tiles.size() != size.x*size.y) {
+						return;
 					}
-					util::INFO("Loaded image texture: " + imgPath);
-					m_imageTextures.push_back(texture);
-				} else {
-					m_imageTextures.push_back(0);
+					TileChunkData chunk;
+					chunk.origin = origin;
+					chunk.size = size;
+					chunk.tiles.reserve(tiles.size());
+					for(const auto& tile : tiles) {
+						chunk.tiles.push_back(packTile(int(tile.ID), int(tile.flipFlags)));
+					}
+					// Empty chunks are not stored
+					if(std::any_of(chunk.tiles.begin(), chunk.tiles.end(), [](uint32_t tile) { return tile != 0; })) {
+						data.chunks.push_back(std::move(chunk));
+					}
+				};
+				if(!res.infinite) {
+					addChunk({0,0}, data.size, layer.getTiles());
+				}
+				// Infinite maps store tiles in chunks, which are inside the layer by construction:
+				for(const auto& chunk : layer.getChunks()) {
+					const auto x = size_t(chunk.position.x - res.tileOrigin.x);
+					const auto y = size_t(chunk.position.y - res.tileOrigin.y);
+					addChunk({x, y}, {size_t(chunk.size.x), size_t(chunk.size.y)}, chunk.tiles);
 				}
+				res.layers.push_back({0, res.tileLayers.size()});
+				res.tileLayers.push_back(std::move(data));
+			} else if(layerType == tmx::Layer::Type::Image) {
+				const tmx::ImageLayer& layer = *dynamic_cast<tmx::ImageLayer*>(layers[layerIndex].get());
+				ImageLayerData data;
+				data.name = layerName;
+				data.imagePath = layer.getImagePath();
+				data.opacity = layer.getOpacity();
+				data.offset = {layer.getOffset().x, layer.getOffset().y};
+				data.repeat = {size_t(layer.getRepeat().x), size_t(layer.getRepeat().y)};
+				data.parallaxFactor = glm::vec2(layer.getParallax().x, layer.getParallax().y);
+				if(layer.hasTransparency()) {
+					data.transparentColor.push_back(layer.getTransparencyColour().r);
+					data.transparentColor.push_back(layer.getTransparencyColour().g);
+					data.transparentColor.push_back(layer.getTransparencyColour().b);
+					data.transparentColor.push_back(layer.getTransparencyColour().a);
+				}
+				res.layers.push_back({1, res.imageLayers.size()});
+				res.imageLayers.push_back(std::move(data));
+			} else if(layerType == tmx::Layer::Type::Group) {
+				util::INFO("Creating map layer: index="+std::to_string(layerIndex)+", type=Group, Name=\"" + layerName + "\"");
+				util::WARN("Group layers are not supported in tmx-maps");
 			} else if(layerType == tmx::Layer::Type::Object) {
-				util::INFO("Creating map layer: index="+std::to_string(layerIndex)+", type=Object, Name=\"" + m_map->getLayers()[layerIndex]->getName() + "\"");
+				util::INFO("Creating map layer: index="+std::to_string(layerIndex)+", type=Object, Name=\"" + layerName + "\"");
 				util::WARN("Object layers are not supported in tmx-maps");
 			} else {
-				util::INFO("Creating map layer: index="+std::to_string(layerIndex)+", type=Unknown, Name=\"" + m_map->getLayers()[layerIndex]->getName() + "\"");
+				util::INFO("Creating map layer: index="+std::to_string(layerIndex)+", type=Unknown, Name=\"" + layerName + "\"");
 				util::ERR("Unknown layer type in tmx-map!");
 			}
 		}
+		return res;
+	}
+
+	/// LayerUniforms
+	LayerUniforms::LayerUniforms(const shader::Shader& shader)
+		: lookupMap(shader.findUniform("lookupMap"))
+		, tileMap(shader.findUniform("tileMap"))
+		, tileMaps(shader.findUniform("tileMaps"))
+		, numTilesets(shader.findUniform("numTilesets"))
+		, firstGID(shader.findUniform("firstGID"))
+		, tileCount(shader.findUniform("tileCount"))
+		, tileSize(shader.findUniform("tileSize"))
+		, tilesetSize(shader.findUniform("tilesetSize"))
+		, uvScale(shader.findUniform("uvScale"))
+		, image(shader.findUniform("image"))
+		, repeat(shader.findUniform("repeat")) {
+	}
+
+	/// Map
+	Map::Map(const std::string& mapFilename, LoadTextureFuncType loadTexture, size_t chunkSize, GetImageFuncType getImage)
+		: m_tileLayerShader(shaders::createTileLayer())
+		, m_imageLayerShader(shaders::createImageLayer())
+		, m_uniformBuffer(std::make_shared<graphics::UniformBuffer>())
+		, m_clearColor(0.5,0.5,0.5,1)
+		, m_mapSize{0,0}
+		, m_tileOrigin{0,0}
+		, m_tileSize{0,0} {
+		if(bake::isBakedMap(mapFilename)) {
+			// Mapping must live until lookup textures are uploaded
+			bake::MappedFile file(mapFilename);
+			create(bake::read(file), loadTexture, chunkSize, getImage);
+			util::INFO("Loaded baked map: " + mapFilename);
+		} else {
+			create(loadTmx(mapFilename), loadTexture, chunkSize, getImage);
+		}
+	}
+
+	Map::Map(const MapData& mapData, LoadTextureFuncType loadTexture, size_t chunkSize, GetImageFuncType getImage)
+		: m_tileLayerShader(shaders::createTileLayer())
+		, m_imageLayerShader(shaders::createImageLayer())
+		, m_uniformBuffer(std::make_shared<graphics::UniformBuffer>())
+		, m_clearColor(0.5,0.5,0.5,1)
+		, m_mapSize{0,0}
+		, m_tileOrigin{0,0}
+		, m_tileSize{0,0} {
+		create(mapData, loadTexture, chunkSize, getImage);
+	}
+
+	void Map::create(const MapData& mapData, LoadTextureFuncType loadTexture, size_t chunkSize, GetImageFuncType getImage) {
+		m_tileLayerUniforms = LayerUniforms(*m_tileLayerShader);
+		m_imageLayerUniforms = LayerUniforms(*m_imageLayerShader);
+		m_clearColor = mapData.clearColor;
+		m_mapSize = mapData.mapSize;
+		m_tileOrigin = mapData.tileOrigin;
+		m_tileSize = mapData.tileSize;
+		m_tileClassBits = mapData.tileClassBits;
+		if(mapData.infinite && chunkSize == 0) {
+			// Infinite maps are always streamed
+			chunkSize = 32;
+		}
+
+		// Create tileset texture array from decoded images, or tileset textures from map tilesets:
+		if(createTilesetArray(mapData, getImage)) {
+			m_tilesetTextures.assign(mapData.tilesets.size(), 0);
+		} else {
+			for(const auto& ts : mapData.tilesets) {
+				auto texture = loadTexture(ts.imagePath);
+				if(texture == 0) {
+					util::ERR("Failed to load tileset texture file: \"" + ts.imagePath + "\"!");
+				}
+				util::INFO("Loaded tileset texture: " + ts.imagePath);
+				m_tilesetTextures.push_back(texture);
+			}
+		}
+
+		// Create image layer textures:
+		for(const auto& layer : mapData.imageLayers) {
+			if(layer.imagePath.size() > 0) {
+				auto texture = loadTexture(layer.imagePath);
+				if(texture == 0) {
+					util::ERR("Failed to load image texture file: \"" + layer.imagePath + "\"!");
+				}
+				texture->setRepeat(true);
+				util::INFO("Loaded image texture: " + layer.imagePath);
+				m_imageTextures.push_back(texture);
+			} else {
+				m_imageTextures.push_back(0);
+			}
+		}
 
 		// Create a drawable object for each layer:
-		std::vector<std::string> layerNames;
-		for(auto i = 0u; i < layers.size(); ++i) {
-			const auto layerType = layers[i]->getType();
-			if(layerType == tmx::Layer::Type::Tile) {
-				m_layerNames[layers[i]->getName()] = i;
-				layerNames.push_back(layers[i]->getName());
+		for(const auto& layer : mapData.layers) {
+			const auto index = layer[1];
+			if(layer[0] == 0) {
+				m_layerNames[mapData.tileLayers[index].name] = m_allLayersMap.size();
 				m_allLayersMap.push_back({0,m_tileLayers.size()});
-				m_tileLayers.push_back(std::make_shared<TileLayer>(*m_map, i, m_tilesetTextures));
-			} else if(layerType == tmx::Layer::Type::Group) {
-				util::WARN("Group layers are not supported in tmx-maps");
-			} else if(layerType == tmx::Layer::Type::Image) {
-				m_layerNames[layers[i]->getName()] = i;
-				layerNames.push_back(layers[i]->getName());
-				m_allLayersMap.push_back({1,m_bgLayers.size()});
-				m_bgLayers.push_back(std::make_shared<ImageLayer>(*m_map, i, m_imageTextures));
-			} else if(layerType == tmx::Layer::Type::Object) {
-				util::WARN("Object layers are not supported in tmx-maps");
+				m_tileLayers.push_back(std::make_shared<TileLayer>(mapData, index, m_tilesetTextures, chunkSize));
+				m_tileLayers.back()->tilesetArray = m_tilesetArray;
 			} else {
-				util::ERR("Unknown layer type in tmx-map!");
+				m_layerNames[mapData.imageLayers[index].name] = m_allLayersMap.size();
+				m_allLayersMap.push_back({1,m_bgLayers.size()});
+				m_bgLayers.push_back(std::make_shared<ImageLayer>(mapData, index, m_imageTextures[index]));
+			}
+		}
+	}
+
+	bool Map::createTilesetArray(const MapData& mapData, GetImageFuncType getImage) {
+		const auto& tilesets = mapData.tilesets;
+		if(getImage == 0 || tilesets.empty() || tilesets.size() > TilesetArray::MAX_TILESETS) {
+			// Too many tilesets for uniform arrays: layers are drawn once per used tileset
+			return false;
+		}
+		// Array layers are uploaded from decoded images, so that tileset textures are not read back from the GPU
+		std::vector<const ImageData*> images;
+		unsigned width = 0;
+		unsigned height = 0;
+		for(const auto& ts : tilesets) {
+			auto image = getImage(ts.imagePath);
+			if(image == 0 || image->channels != 4) {
+				util::INFO("Tileset image is not available as RGBA image, tilesets are drawn without texture array: " + ts.imagePath);
+				return false;
 			}
+			images.push_back(image);
+			width = std::max(width, unsigned(image->size.x));
+			height = std::max(height, unsigned(image->size.y));
 		}
+		auto tilesetArray = std::make_shared<TilesetArray>();
+		tilesetArray->texture = std::make_shared<texture::TextureArray>(width, height, unsigned(tilesets.size()));
+		for(size_t i = 0; i < tilesets.size(); ++i) {
+			const auto& image = *images[i];
+			tilesetArray->texture->setLayerData(unsigned(i), unsigned(image.size.x), unsigned(image.size.y), image.pixels.data());
+			tilesetArray->firstGID.push_back(tilesets[i].firstGID);
+			tilesetArray->tileCount.push_back(tilesets[i].tileCount);
+			tilesetArray->tileSize.insert(tilesetArray->tileSize.end(), {float(tilesets[i].tileSize.x), float(tilesets[i].tileSize.y)});
+			tilesetArray->tilesetSize.insert(tilesetArray->tilesetSize.end(), {float(tilesets[i].tilesetSize.x), float(tilesets[i].tilesetSize.y)});
+			tilesetArray->uvScale.insert(tilesetArray->uvScale.end(), {float(image.size.x) / float(width), float(image.size.y) / float(height)});
+		}
+		m_tilesetArray = tilesetArray;
+		m_tileLayerArrayShader = shaders::createTileLayerArray(TilesetArray::MAX_TILESETS);
+		m_tileLayerArrayUniforms = LayerUniforms(*m_tileLayerArrayShader);
+		return true;
 	}
 
 	size2d_t Map::getTileSize() const {
-		auto& s = m_map->getTileSize();
-		return {s.x, s.y};
+		return m_tileSize;
 	}
 
 	size2d_t Map::getMapSize() const {
-		auto& s = m_map->getTileCount();
-		return {s.x, s.y};
+		return m_mapSize;
+	}
+
+	int2d_t Map::getTileOrigin() const {
+		return m_tileOrigin;
 	}
 
 
 	Map::MapCollision Map::checkCollision(const std::string& layerName, const glm::vec3 position, glm::vec3 halfSize) const {
+		auto fixed = checkCollision(getLayerIndex(layerName), position, halfSize);
+		MapCollision colMap;
+		for(const auto& row : fixed.cells) {
+			colMap.push_back(std::vector<glm::vec3>(row.begin(), row.end()));
+		}
+		return colMap;
+	}
+
+	Map::FixedMapCollision Map::checkCollision(size_t layerId, const glm::vec3 position, glm::vec3 halfSize) const {
 		// Ckeck map limits
 		auto mapSize = getMapSize();
 		mapSize.x -= 1;
 		mapSize.y -= 1;
 
-		MapCollision colMap = util::gridN(3, glm::vec3(-1));
+		const auto& layer = getTileLayer(layerId);
+		FixedMapCollision colMap;
 		auto set = [&colMap](size2d_t p, glm::vec3 val) {
 			auto getValue = [](float m, float v){
 				//float S = 0.00001f;
@@ -346,14 +845,13 @@ namespace map {
 			colMap[p.y][p.x].z = getValue(colMap[p.y][p.x].z, val.z);
 		};
 
-		auto getOverlap = [this,&layerName](int2d_t mapDir, glm::vec3 position, const glm::vec3& halfSize) {
-			auto layer = getLayerIndex(layerName);
+		auto getOverlap = [&layer](int2d_t mapDir, glm::vec3 position, const glm::vec3& halfSize) {
 			//position -= glm::vec3(0.5, 0.5, 0.0);
 			int2d_t pos = {int(position.x+0.5f),int(position.y+0.5f)};
 			int mx = mapDir.x + pos.x;
 			int my = mapDir.y + pos.y;
 
-			if(getTileId(layer, mx, my) > 0) {
+			if(layer.isSolid(size_t(mx), size_t(my))) {
 				auto o1 = aabb::createAABB(glm::vec3(position.x, position.y, 0.0f), halfSize);
 				auto o2 = aabb::createAABB(glm::vec3(float(mx), float(my), 0.0f), glm::vec3(0.5f));
 				auto abs = [](glm::vec3 v) { return glm::abs(v); };
@@ -417,6 +915,38 @@ namespace map {
 		return colMap;
 	}
 
+	void Map::updateChunks(const glm::vec2& viewCenter, const glm::vec2& viewHalfSize, float margin) {
+		// Tile x,y covers x-0.5..x+0.5, y-0.5..y+0.5:
+		const auto lo = viewCenter - viewHalfSize - glm::vec2(margin) + glm::vec2(0.5f);
+		const auto hi = viewCenter + viewHalfSize + glm::vec2(margin) + glm::vec2(0.5f);
+		for(auto& layer : m_tileLayers) {
+			if(layer->chunkSize == 0) {
+				continue;
+			}
+			const float cs = float(layer->chunkSize);
+			const int cx0 = int(std::floor(lo.x / cs));
+			const int cy0 = int(std::floor(lo.y / cs));
+			const int cx1 = int(std::floor(hi.x / cs));
+			const int cy1 = int(std::floor(hi.y / cs));
+			for(size_t i = 0; i < layer->chunks.size(); ++i) {
+				const int cx = int(layer->chunks[i].origin.x / layer->chunkSize);
+				const int cy = int(layer->chunks[i].origin.y / layer->chunkSize);
+				const bool inView = cx >= cx0 && cx <= cx1 && cy >= cy0 && cy <= cy1;
+				layer->setChunkResident(i, inView);
+			}
+		}
+	}
+
+	size_t Map::getNumResidentChunks() const {
+		size_t res = 0;
+		for(const auto& layer : m_tileLayers) {
+			for(const auto& chunk : layer->chunks) {
+				res += chunk.resident ? 1 : 0;
+			}
+		}
+		return res;
+	}
+
 	const size_t Map::getNumLayers() const {
 		return m_tileLayers.size();
 	}
@@ -429,28 +959,272 @@ namespace map {
 		return it->second;
 	}
 
-	int Map::getTileId(size_t layerId, size_t x, size_t y) const {
-		if(x < 0.0f || y < 0.0f) {
-			return -1;
-		}
+	const TileLayer& Map::getTileLayer(size_t layerId) const {
+		assert(layerId < m_allLayersMap.size());
+		assert(m_allLayersMap[layerId][0] == 0);
 		auto tileLayerId = m_allLayersMap[layerId][1];
 		assert(tileLayerId < m_tileLayers.size());
-		const auto& layer = m_tileLayers[tileLayerId];
-		if(y >= layer->tileIds.size() || x >= layer->tileIds[y].size()) {
-			return -1;
+		return *m_tileLayers[tileLayerId];
+	}
+
+	TileLayer& Map::getTileLayer(size_t layerId) {
+		return const_cast<TileLayer&>(static_cast<const Map*>(this)->getTileLayer(layerId));
+	}
+
+	void Map::setTile(size_t layerId, size_t x, size_t y, int tileId, int flipFlags) {
+		getTileLayer(layerId).setTile(x, y, tileId, flipFlags);
+	}
+
+	void Map::fillRect(size_t layerId, size_t x, size_t y, size_t width, size_t height, int tileId, int flipFlags) {
+		getTileLayer(layerId).fillRect(x, y, width, height, tileId, flipFlags);
+	}
+
+	void Map::flushTileEdits() {
+		for(auto& layer : m_tileLayers) {
+			layer->flush();
+		}
+	}
+
+	int Map::getTileId(size_t layerId, size_t x, size_t y) const {
+		// Negative coordinates wrap to large values and fail the bounds check:
+		return getTileLayer(layerId).getTileId(x, y);
+	}
+
+	bool Map::isSolid(size_t layerId, size_t x, size_t y) const {
+		return getTileLayer(layerId).isSolid(x, y);
+	}
+
+	bool Map::isAnySolid(size_t layerId, size_t x0, size_t y0, size_t x1, size_t y1) const {
+		return getTileLayer(layerId).isAnySolid(x0, y0, x1, y1);
+	}
+
+	uint32_t Map::getTileClasses(size_t layerId, size_t x, size_t y) const {
+		return getTileLayer(layerId).getTileClasses(x, y);
+	}
+
+	uint32_t Map::getTileClassMask(const std::string& className) const {
+		auto it = m_tileClassBits.find(className);
+		if(it == m_tileClassBits.end()) {
+			return 0;
+		}
+		return uint32_t(1) << it->second;
+	}
+
+	static inline RayHit traceRay(const TileLayer& layer, float originX, float originY, float dirX, float dirY, float maxDistance) {
+		RayHit res;
+		const float len = std::sqrt(dirX*dirX + dirY*dirY);
+		const auto size = layer.getSize();
+		if(len <= 0.0f || size.x == 0 || size.y == 0) {
+			return res;
+		}
+		dirX /= len;
+		dirY /= len;
+		// Shift half tile, so that tile i covers [i, i+1) on both axes:
+		const float px = originX + 0.5f;
+		const float py = originY + 0.5f;
+		const float INF = std::numeric_limits<float>::infinity();
+
+		// Clip ray to map bounds, remembering which face the ray enters from:
+		float tEnter = 0.0f;
+		float tExit = maxDistance;
+		glm::vec2 normal(0);
+		auto clip = [&](float p, float d, float hi, glm::vec2 axis) {
+			if(d == 0.0f) {
+				return p >= 0.0f && p < hi;
+			}
+			float t0 = (0.0f - p) / d;
+			float t1 = (hi - p) / d;
+			if(t0 > t1) {
+				std::swap(t0, t1);
+			}
+			if(t0 > tEnter) {
+				tEnter = t0;
+				normal = d > 0.0f ? -axis : axis;
+			}
+			tExit = std::min(tExit, t1);
+			return tEnter <= tExit;
+		};
+		if(!clip(px, dirX, float(size.x), glm::vec2(1,0)) || !clip(py, dirY, float(size.y), glm::vec2(0,1))) {
+			return res;
+		}
+
+		auto clampi = [](int v, size_t hi) {
+			return std::max(0, std::min(v, int(hi)-1));
+		};
+		int x = clampi(int(std::floor(px + dirX*tEnter)), size.x);
+		int y = clampi(int(std::floor(py + dirY*tEnter)), size.y);
+		const int stepX = dirX > 0.0f ? 1 : -1;
+		const int stepY = dirY > 0.0f ? 1 : -1;
+		const float tDeltaX = dirX != 0.0f ? std::abs(1.0f / dirX) : INF;
+		const float tDeltaY = dirY != 0.0f ? std::abs(1.0f / dirY) : INF;
+		float tMaxX = dirX > 0.0f ? (float(x + 1) - px) / dirX : (dirX < 0.0f ? (float(x) - px) / dirX : INF);
+		float tMaxY = dirY > 0.0f ? (float(y + 1) - py) / dirY : (dirY < 0.0f ? (float(y) - py) / dirY : INF);
+		float t = tEnter;
+		// Chunk of the current tile is searched only when the ray leaves the previous chunk
+		const TileChunk* chunk = 0;
+		while(true) {
+			if(chunk == 0 || !chunk->contains(size_t(x), size_t(y))) {
+				chunk = layer.findChunk(size_t(x), size_t(y));
+			}
+			if(chunk != 0 && chunk->isSolid(size_t(x), size_t(y))) {
+				res.hit = true;
+				res.tile = {x, y};
+				res.distance = t;
+				res.normal = normal;
+				return res;
+			}
+			if(tMaxX < tMaxY) {
+				t = tMaxX;
+				x += stepX;
+				tMaxX += tDeltaX;
+				normal = glm::vec2(float(-stepX), 0.0f);
+			} else {
+				t = tMaxY;
+				y += stepY;
+				tMaxY += tDeltaY;
+				normal = glm::vec2(0.0f, float(-stepY));
+			}
+			if(t > tExit || x < 0 || y < 0 || x >= int(size.x) || y >= int(size.y)) {
+				return res;
+			}
 		}
-		return layer->tileIds[y][x];
 	}
 
+	RayHit Map::raycast(size_t layerId, const glm::vec2& origin, const glm::vec2& direction, float maxDistance) const {
+		return traceRay(getTileLayer(layerId), origin.x, origin.y, direction.x, direction.y, maxDistance);
+	}
+
+	void Map::raycastBatch(size_t layerId, const RayBatch& rays, RayHitBatch& hits) const {
+		const auto& layer = getTileLayer(layerId);
+		const size_t n = rays.size();
+		hits.resize(n);
+		const float* ox = rays.originX.data();
+		const float* oy = rays.originY.data();
+		const float* dx = rays.directionX.data();
+		const float* dy = rays.directionY.data();
+		const float* md = rays.maxDistance.data();
+		for(size_t i = 0; i < n; ++i) {
+			const auto h = traceRay(layer, ox[i], oy[i], dx[i], dy[i], md[i]);
+			hits.hit[i]		= h.hit ? 1 : 0;
+			hits.tileX[i]	= h.tile.x;
+			hits.tileY[i]	= h.tile.y;
+			hits.distance[i]= h.distance;
+			hits.normalX[i]	= h.normal.x;
+			hits.normalY[i]	= h.normal.y;
+		}
+	}
+
+	SweepHit Map::sweepAABB(size_t layerId, const glm::vec3& position, const glm::vec3& halfSize, const glm::vec3& displacement) const {
+		const auto& layer = getTileLayer(layerId);
+		const auto mapSize = getMapSize();
+		const float INF = std::numeric_limits<float>::infinity();
+		SweepHit res;
+		res.position = position + displacement;
+
+		// Slab test of moving point p against interval lo..hi. Touching is not overlapping.
+		auto slab = [INF](float p, float d, float lo, float hi, float& tEntry, float& tExit) {
+			if(d == 0.0f) {
+				tEntry = (p > lo && p < hi) ? -INF : INF;
+				tExit = INF;
+			} else if(d > 0.0f) {
+				tEntry = (lo - p) / d;
+				tExit = (hi - p) / d;
+			} else {
+				tEntry = (hi - p) / d;
+				tExit = (lo - p) / d;
+			}
+		};
+
+		auto testBox = [&](const glm::vec2& lo, const glm::vec2& hi, int2d_t tile) {
+			float txEntry, txExit, tyEntry, tyExit;
+			slab(position.x, displacement.x, lo.x, hi.x, txEntry, txExit);
+			slab(position.y, displacement.y, lo.y, hi.y, tyEntry, tyExit);
+			const float tEntry = std::max(txEntry, tyEntry);
+			const float tExit = std::min(txExit, tyExit);
+			if(tEntry >= tExit || tEntry < 0.0f || tEntry > 1.0f || tExit <= 0.0f || (res.hit && tEntry >= res.time)) {
+				return;
+			}
+			res.hit = true;
+			res.time = tEntry;
+			res.tile = tile;
+			res.position = position + tEntry * displacement;
+			if(txEntry > tyEntry) {
+				res.normal = glm::vec2(displacement.x > 0.0f ? -1.0f : 1.0f, 0.0f);
+				res.position.x = displacement.x > 0.0f ? lo.x : hi.x;
+			} else {
+				res.normal = glm::vec2(0.0f, displacement.y > 0.0f ? -1.0f : 1.0f);
+				res.position.y = displacement.y > 0.0f ? lo.y : hi.y;
+			}
+		};
+
+		// Map borders limit box center to 0..size-1, same as in checkCollision:
+		auto testBorder = [&](int axis, float limit, bool isMax) {
+			const float p = position[axis];
+			const float d = displacement[axis];
+			if((isMax && d <= 0.0f) || (!isMax && d >= 0.0f) || (isMax && p + d <= limit) || (!isMax && p + d >= limit)) {
+				return;
+			}
+			const float t = std::max(0.0f, (limit - p) / d);
+			if(res.hit && t >= res.time) {
+				return;
+			}
+			res.hit = true;
+			res.time = t;
+			res.tile = {-1,-1};
+			res.position = position + t * displacement;
+			res.position[axis] = limit;
+			res.normal = glm::vec2(0);
+			res.normal[axis] = isMax ? -1.0f : 1.0f;
+		};
+		testBorder(0, 0.0f, false);
+		testBorder(0, float(mapSize.x) - 1.0f, true);
+		testBorder(1, 0.0f, false);
+		testBorder(1, float(mapSize.y) - 1.0f, true);
+
+		// Tiles overlapping the swept bounds. Tile x,y covers x-0.5..x+0.5, y-0.5..y+0.5.
+		const auto end = position + displacement;
+		const float minX = std::min(position.x, end.x) - halfSize.x;
+		const float maxX = std::max(position.x, end.x) + halfSize.x;
+		const float minY = std::min(position.y, end.y) - halfSize.y;
+		const float maxY = std::max(position.y, end.y) + halfSize.y;
+		const auto gridSize = layer.getSize();
+		if(gridSize.x == 0 || gridSize.y == 0) {
+			return res;
+		}
+		auto toTile = [](float v, size_t n) {
+			return std::max(0, std::min(int(std::floor(v + 0.5f)), int(n)-1));
+		};
+		const int x0 = toTile(minX, gridSize.x);
+		const int x1 = toTile(maxX, gridSize.x);
+		const int y0 = toTile(minY, gridSize.y);
+		const int y1 = toTile(maxY, gridSize.y);
+		for(int y = y0; y <= y1; ++y) {
+			if(!layer.isAnySolid(size_t(x0), size_t(y), size_t(x1), size_t(y))) {
+				continue;
+			}
+			for(int x = x0; x <= x1; ++x) {
+				if(layer.isSolid(size_t(x), size_t(y))) {
+					// Tile box expanded by half size of the swept box:
+					const auto lo = glm::vec2(float(x) - 0.5f - halfSize.x, float(y) - 0.5f - halfSize.y);
+					const auto hi = glm::vec2(float(x) + 0.5f + halfSize.x, float(y) + 0.5f + halfSize.y);
+					testBox(lo, hi, {x, y});
+				}
+			}
+		}
+		return res;
+	}
+
+	bool Map::hasLineOfSight(size_t layerId, const glm::vec2& from, const glm::vec2& to) const {
+		const auto d = to - from;
+		return !raycast(layerId, from, d, glm::length(d)).hit;
+	}
 
 	const Objects& Map::getLayerObjects(size_t layerId) const {
-		return m_tileLayers[layerId]->objects;
+		return getTileLayer(layerId).objects;
 	}
 
 	template<typename Subset>
-	void applyLayerSubset(const Subset& subset, shader::ShaderPass shader, const glm::mat4& matProjection, const glm::vec2& cameraDelta) {
-		assert(subset.used);
-
+	glm::vec2 getParallax(const Subset& subset, const glm::vec2& cameraDelta) {
 		float paralX = 0;
 		if(subset.parallaxFactor.x == 1.0f) {
 			paralX = 0;
@@ -467,34 +1241,82 @@ namespace map {
 		} else {
 			paralY = subset.parallaxFactor.y * cameraDelta.y;
 		}
-		// Set map properties
-		shader.setUniformm("P",			&matProjection[0][0], false);
-		shader.setUniform( "offset",	float(subset.offset.x), float(subset.offset.y));
-		shader.setUniform( "opacity",	subset.opacity);
-		shader.setUniform( "parallax",	-paralX, paralY);
+		return glm::vec2(-paralX, paralY);
+	}
+
+	///
+	/// \brief getVisibleRect intersects quad of the subset with the view volume of the projection.
+	/// \param visible Visible part of the quad in mesh coordinates: min xy, max xy.
+	/// \return false, if nothing of the subset is visible.
+	///
+	template<typename Subset>
+	bool getVisibleRect(const Subset& subset, const glm::mat4& matProjection, const glm::vec2& parallax, glm::vec4& visible) {
+		if(subset.opacity <= 0.0f) {
+			return false;
+		}
+		// Unproject screen corners and undo the layer shift done in the vertex shader
+		const auto invProjection = glm::inverse(matProjection);
+		const auto shift = parallax + glm::vec2(subset.offset.x, subset.offset.y);
+		glm::vec2 viewMin(std::numeric_limits<float>::max());
+		glm::vec2 viewMax(std::numeric_limits<float>::lowest());
+		for(auto corner : {glm::vec2(-1,-1), glm::vec2(1,-1), glm::vec2(-1,1), glm::vec2(1,1)}) {
+			auto p = invProjection * glm::vec4(corner, 0.0f, 1.0f);
+			auto layerPos = glm::vec2(p) / p.w - shift;
+			viewMin = glm::min(viewMin, layerPos);
+			viewMax = glm::max(viewMax, layerPos);
+		}
+		const auto quadMin = glm::vec2(subset.rect.x, subset.rect.y);
+		const auto quadMax = quadMin + glm::vec2(subset.rect.z, subset.rect.w);
+		visible = glm::vec4(glm::max(viewMin, quadMin), glm::min(viewMax, quadMax));
+		return visible.x < visible.z && visible.y < visible.w;
+	}
+
+	///
+	/// \brief applyLayerSubset sets layer uniforms and clips the quad of the subset to the screen.
+	/// \return false, if the subset is off-screen or fully transparent and must not be drawn.
+	///
+	template<typename Subset>
+	bool applyLayerSubset(const Subset& subset, graphics::UniformBuffer& uniforms, const glm::mat4& matProjection, const glm::vec2& cameraDelta) {
+		assert(subset.used);
+		const auto parallax = getParallax(subset, cameraDelta);
+		glm::vec4 visible;
+		if(!getVisibleRect(subset, matProjection, parallax, visible)) {
+			return false;
+		}
+		// Set map properties. Vertices are clamped to the visible rectangle, so only on-screen fragments are shaded.
+		graphics::LayerData layerData;
+		layerData.offset		= glm::vec2(subset.offset.x, subset.offset.y);
+		layerData.parallax		= parallax;
+		layerData.clipMin		= glm::vec2(visible.x, visible.y);
+		layerData.clipMax		= glm::vec2(visible.z, visible.w);
+		layerData.texCoordScale	= subset.texScale / glm::vec2(subset.rect.z, subset.rect.w);
+		layerData.opacity		= subset.opacity;
+		layerData.padding		= 0.0f;
+		uniforms.push(shader::LAYER_DATA_BINDING, layerData);
+		return true;
 	}
 
-	void draw(const ImageLayer& layer, shader::ShaderPass shader, const glm::mat4& matProjection, const glm::vec2& cameraDelta) {
+	void draw(const ImageLayer& layer, shader::ShaderPass shader, const LayerUniforms& u, graphics::UniformBuffer& uniforms, const glm::mat4& matProjection, const glm::vec2& cameraDelta) {
 		auto& subset = layer.subset;
-		if(subset.used) {
-			applyLayerSubset(subset, shader, matProjection, cameraDelta);
-			shader.setUniform("repeat", float(subset.repeat.x), float(subset.repeat.y));
-			shader.setUniform("image", 0);
+		if(subset.used && applyLayerSubset(subset, uniforms, matProjection, cameraDelta)) {
+			shader.setUniform(u.repeat, float(subset.repeat.x), float(subset.repeat.y));
+			shader.setUniform(u.image, 0);
 			subset.texture->bind(0);
 			assert(subset.mesh != 0);
 			quad::drawImage(*subset.mesh);
 		}
 	}
 
-	void draw(const TileLayer& layer, shader::ShaderPass shader, const glm::mat4& matProjection, const glm::vec2& cameraDelta) {
-		for(const auto& subset : layer.subsets)	{
-			if(subset.used) {
-				applyLayerSubset(subset, shader, matProjection, cameraDelta);
-				shader.setUniform("tileSize", float(subset.tileSize.x), float(subset.tileSize.y));
-				shader.setUniform("tilesetSize", float(subset.tilesetSize.x), float(subset.tilesetSize.y));
-				shader.setUniform("lookupMap", 0);
+	void draw(const std::vector<TileSetSubset>& subsets, shader::ShaderPass shader, const LayerUniforms& u, graphics::UniformBuffer& uniforms, const glm::mat4& matProjection, const glm::vec2& cameraDelta) {
+		for(const auto& subset : subsets)	{
+			if(subset.used && applyLayerSubset(subset, uniforms, matProjection, cameraDelta)) {
+				shader.setUniform(u.tileSize, float(subset.tileSize.x), float(subset.tileSize.y));
+				shader.setUniform(u.tilesetSize, float(subset.tilesetSize.x), float(subset.tilesetSize.y));
+				shader.setUniform(u.firstGID, subset.firstGID);
+				shader.setUniform(u.tileCount, subset.tileCount);
+				shader.setUniform(u.lookupMap, 0);
 				subset.colorLookup->bind(0);
-				shader.setUniform("tileMap", 1);
+				shader.setUniform(u.tileMap, 1);
 				subset.tileMap->bind(1);
 				assert(subset.mesh != 0);
 				quad::drawImage(*subset.mesh);
@@ -502,6 +1324,46 @@ namespace map {
 		}
 	}
 
+	// Draws all used subsets with one draw call. Subsets share mesh and lookup texture of the layer or chunk.
+	// Tileset array must be bound and its uniforms set by the caller.
+	void drawWithTilesetArray(const std::vector<TileSetSubset>& subsets, shader::ShaderPass shader, const LayerUniforms& u, graphics::UniformBuffer& uniforms, const glm::mat4& matProjection, const glm::vec2& cameraDelta) {
+		auto used = std::find_if(subsets.begin(), subsets.end(), [](const TileSetSubset& subset) { return subset.used; });
+		if(used == subsets.end() || !applyLayerSubset(*used, uniforms, matProjection, cameraDelta)) {
+			return;
+		}
+		shader.setUniform(u.lookupMap, 0);
+		used->colorLookup->bind(0);
+		assert(used->mesh != 0);
+		quad::drawImage(*used->mesh);
+	}
+
+	void draw(const TileLayer& layer, shader::ShaderPass shader, const LayerUniforms& u, graphics::UniformBuffer& uniforms, const glm::mat4& matProjection, const glm::vec2& cameraDelta) {
+		if(layer.tilesetArray != 0) {
+			// Tileset uniforms are same for all chunks
+			const auto& tilesetArray = *layer.tilesetArray;
+			const auto numTilesets = tilesetArray.firstGID.size();
+			shader.setUniform(u.numTilesets, int(numTilesets));
+			shader.setUniformArray(u.firstGID, tilesetArray.firstGID.data(), numTilesets);
+			shader.setUniformArray(u.tileCount, tilesetArray.tileCount.data(), numTilesets);
+			shader.setUniformArray2(u.tileSize, tilesetArray.tileSize.data(), numTilesets);
+			shader.setUniformArray2(u.tilesetSize, tilesetArray.tilesetSize.data(), numTilesets);
+			shader.setUniformArray2(u.uvScale, tilesetArray.uvScale.data(), numTilesets);
+			shader.setUniform(u.tileMaps, 1);
+			tilesetArray.texture->bind(1);
+			for(const auto& chunk : layer.chunks) {
+				if(chunk.resident) {
+					drawWithTilesetArray(chunk.subsets, shader, u, uniforms, matProjection, cameraDelta);
+				}
+			}
+			return;
+		}
+		for(const auto& chunk : layer.chunks) {
+			if(chunk.resident) {
+				draw(chunk.subsets, shader, u, uniforms, matProjection, cameraDelta);
+			}
+		}
+	}
+
 	bool isPenetrating(const Map::MapCollision& col) {
 		for(size_t i=0; i<col.size(); ++i) {
 			for(size_t j=0; j<col[i].size(); ++j) {
@@ -513,6 +1375,17 @@ namespace map {
 		return false;
 	}
 
+	bool isPenetrating(const Map::FixedMapCollision& col) {
+		for(const auto& row : col.cells) {
+			for(const auto& c : row) {
+				if(c.x > 0.0f || c.y > 0.0f) {
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
 	void draw(const Map& map, const glm::mat4& matProjection, const glm::vec2& cameraDelta) {
 		// Clear screen:
 		auto clearColor = map.getClearColor();
@@ -525,22 +1398,32 @@ namespace map {
 		checkGLError();
 
 		// Enable alpha blending:
-		glEnable(GL_BLEND);
+		glstate::setBlend(true);
 		checkGLError();
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glstate::setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 		checkGLError();
 
+		// Projection is shared by all layers
+		graphics::FrameData frameData;
+		frameData.P = matProjection;
+		frameData.camera = glm::vec4(cameraDelta, 0.0f, 0.0f);
+		map.m_uniformBuffer->push(shader::FRAME_DATA_BINDING, frameData);
+
 		// Render all layers:
 		for(size_t layerId=0; layerId<map.getAllLayers().size(); ++layerId) {
 			auto type = map.getAllLayers()[layerId][0];
 			auto index = map.getAllLayers()[layerId][1];
 			if(type==0) {
-				map.m_tileLayerShader->use([&](shader::ShaderPass shader) {
-					draw(*map.getTileLayers()[index], shader, matProjection, cameraDelta);
+				const auto& layer = *map.getTileLayers()[index];
+				const bool useArray = layer.tilesetArray != 0;
+				const auto& layerShader = useArray ? map.m_tileLayerArrayShader : map.m_tileLayerShader;
+				const auto& layerUniforms = useArray ? map.m_tileLayerArrayUniforms : map.m_tileLayerUniforms;
+				layerShader->use([&](shader::ShaderPass shader) {
+					draw(layer, shader, layerUniforms, *map.m_uniformBuffer, matProjection, cameraDelta);
 				});
 			} else if(type==1) {
 				map.m_imageLayerShader->use([&](shader::ShaderPass shader) {
-					draw(*map.getImageLayers()[index], shader, matProjection, cameraDelta);
+					draw(*map.getImageLayers()[index], shader, map.m_imageLayerUniforms, *map.m_uniformBuffer, matProjection, cameraDelta);
 				});
 			}
 		}
@@ -0,0 +1,376 @@
+/*=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+ MIT License
+
+ Copyright (c) 2022 Mikko Romppainen (kajakbros@gmail.com)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
+#include <hungerland/map_bake.h>
+#include <hungerland/util.h>
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace hungerland {
+namespace map {
+namespace bake {
+	namespace {
+		const char MAGIC[4] = {'H','L','M','B'};
+
+		struct Header {
+			char magic[4];
+			uint32_t version;
+			uint32_t mapSize[2];
+			uint32_t tileSize[2];
+			int32_t tileOrigin[2];
+			float bounds[4];
+			float clearColor[4];
+			uint32_t infinite;
+			uint32_t numTilesets;
+			uint32_t numTileClasses;
+			uint32_t numClassesByTileId;
+			uint32_t numLayers;
+		};
+
+		class Writer {
+		public:
+			explicit Writer(const std::string& filename)
+				: m_file(filename, std::ios::binary) {
+				if(!m_file) {
+					util::ERR("Failed to open baked map file for writing: \"" + filename + "\"!");
+				}
+			}
+
+			template<typename T>
+			void put(const T& value) {
+				putArray(&value, 1);
+			}
+
+			template<typename T>
+			void putArray(const T* values, size_t count) {
+				m_file.write(reinterpret_cast<const char*>(values), std::streamsize(sizeof(T)*count));
+			}
+
+			void putString(const std::string& str) {
+				put(uint32_t(str.size()));
+				putArray(str.data(), str.size());
+				// Keep next field 4 byte aligned
+				const char pad[4] = {0,0,0,0};
+				putArray(pad, (4 - str.size()%4) % 4);
+			}
+
+			bool good() const {
+				return m_file.good();
+			}
+
+		private:
+			std::ofstream m_file;
+		};
+
+		class Reader {
+		public:
+			Reader(const uint8_t* data, size_t size)
+				: m_data(data)
+				, m_size(size)
+				, m_pos(0) {
+			}
+
+			template<typename T>
+			T get() {
+				T value;
+				std::memcpy(&value, getArray<T>(1), sizeof(T));
+				return value;
+			}
+
+			template<typename T>
+			const T* getArray(size_t count) {
+				if(count*sizeof(T) > m_size - m_pos) {
+					util::ERR("Baked map file is truncated!");
+				}
+				auto res = reinterpret_cast<const T*>(m_data + m_pos);
+				m_pos += count*sizeof(T);
+				return res;
+			}
+
+			std::string getString() {
+				auto size = get<uint32_t>();
+				auto str = getArray<char>(size);
+				getArray<char>((4 - size%4) % 4);
+				return std::string(str, size);
+			}
+
+		private:
+			const uint8_t*	m_data;
+			size_t			m_size;
+			size_t			m_pos;
+		};
+
+		std::string toRelativePath(const std::string& path, const std::filesystem::path& baseDir) {
+			std::error_code ec;
+			auto res = std::filesystem::relative(path, baseDir, ec);
+			if(ec || res.empty()) {
+				return path;
+			}
+			return res.generic_string();
+		}
+
+		std::string toLoadPath(const std::string& path, const std::filesystem::path& baseDir) {
+			std::filesystem::path p(path);
+			if(path.empty() || p.is_absolute()) {
+				return path;
+			}
+			return (baseDir / p).lexically_normal().generic_string();
+		}
+	}
+
+	/// MappedFile
+	MappedFile::MappedFile(const std::string& filename)
+		: m_filename(filename)
+		, m_data(0)
+		, m_size(0) {
+#if defined(_WIN32)
+		m_file = 0;
+		m_mapping = 0;
+		HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+		if(file == INVALID_HANDLE_VALUE) {
+			util::ERR("Failed to open baked map file: \"" + filename + "\"!");
+		}
+		LARGE_INTEGER size;
+		GetFileSizeEx(file, &size);
+		HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+		if(mapping == 0) {
+			CloseHandle(file);
+			util::ERR("Failed to map baked map file: \"" + filename + "\"!");
+		}
+		m_file = file;
+		m_mapping = mapping;
+		m_data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		m_size = size_t(size.QuadPart);
+#else
+		int fd = open(filename.c_str(), O_RDONLY);
+		if(fd < 0) {
+			util::ERR("Failed to open baked map file: \"" + filename + "\"!");
+		}
+		struct stat st;
+		if(fstat(fd, &st) != 0 || st.st_size == 0) {
+			close(fd);
+			util::ERR("Failed to read baked map file: \"" + filename + "\"!");
+		}
+		void* data = mmap(0, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		// Mapping keeps the file referenced
+		close(fd);
+		if(data == MAP_FAILED) {
+			util::ERR("Failed to map baked map file: \"" + filename + "\"!");
+		}
+		m_data = static_cast<const uint8_t*>(data);
+		m_size = size_t(st.st_size);
+#endif
+	}
+
+	MappedFile::~MappedFile() {
+#if defined(_WIN32)
+		if(m_data) UnmapViewOfFile(m_data);
+		if(m_mapping) CloseHandle(m_mapping);
+		if(m_file) CloseHandle(m_file);
+#else
+		if(m_data) munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+	}
+
+	bool isBakedMap(const std::string& filename) {
+		std::ifstream file(filename, std::ios::binary);
+		char magic[4] = {0,0,0,0};
+		file.read(magic, 4);
+		return file.good() && std::memcmp(magic, MAGIC, 4) == 0;
+	}
+
+	void write(const MapData& mapData, const std::string& filename) {
+		const auto baseDir = std::filesystem::absolute(filename).parent_path();
+		Writer writer(filename);
+
+		Header header;
+		std::memcpy(header.magic, MAGIC, 4);
+		header.version = VERSION;
+		header.mapSize[0] = uint32_t(mapData.mapSize.x);
+		header.mapSize[1] = uint32_t(mapData.mapSize.y);
+		header.tileSize[0] = uint32_t(mapData.tileSize.x);
+		header.tileSize[1] = uint32_t(mapData.tileSize.y);
+		header.tileOrigin[0] = int32_t(mapData.tileOrigin.x);
+		header.tileOrigin[1] = int32_t(mapData.tileOrigin.y);
+		for(int i = 0; i < 4; ++i) {
+			header.bounds[i] = mapData.bounds[i];
+			header.clearColor[i] = mapData.clearColor[i];
+		}
+		header.infinite = mapData.infinite ? 1 : 0;
+		header.numTilesets = uint32_t(mapData.tilesets.size());
+		header.numTileClasses = uint32_t(mapData.tileClassBits.size());
+		header.numClassesByTileId = uint32_t(mapData.classesByTileId.size());
+		header.numLayers = uint32_t(mapData.layers.size());
+		writer.put(header);
+
+		for(const auto& ts : mapData.tilesets) {
+			writer.putString(toRelativePath(ts.imagePath, baseDir));
+			writer.put(uint32_t(ts.tileSize.x));
+			writer.put(uint32_t(ts.tileSize.y));
+			writer.put(uint32_t(ts.tilesetSize.x));
+			writer.put(uint32_t(ts.tilesetSize.y));
+			writer.put(int32_t(ts.firstGID));
+			writer.put(int32_t(ts.tileCount));
+		}
+
+		for(const auto& tileClass : mapData.tileClassBits) {
+			writer.putString(tileClass.first);
+			writer.put(uint32_t(tileClass.second));
+		}
+		writer.putArray(mapData.classesByTileId.data(), mapData.classesByTileId.size());
+
+		for(const auto& layer : mapData.layers) {
+			writer.put(uint32_t(layer[0]));
+			if(layer[0] == 0) {
+				const auto& data = mapData.tileLayers[layer[1]];
+				writer.putString(data.name);
+				writer.put(data.opacity);
+				writer.put(int32_t(data.offset.x));
+				writer.put(int32_t(data.offset.y));
+				writer.put(uint32_t(data.size.x));
+				writer.put(uint32_t(data.size.y));
+				writer.put(uint32_t(data.chunks.size()));
+				for(const auto& chunk : data.chunks) {
+					writer.put(uint32_t(chunk.origin.x));
+					writer.put(uint32_t(chunk.origin.y));
+					writer.put(uint32_t(chunk.size.x));
+					writer.put(uint32_t(chunk.size.y));
+					writer.putArray(chunk.getTiles(), chunk.size.x*chunk.size.y);
+				}
+			} else {
+				const auto& data = mapData.imageLayers[layer[1]];
+				writer.putString(data.name);
+				writer.put(data.opacity);
+				writer.put(int32_t(data.offset.x));
+				writer.put(int32_t(data.offset.y));
+				writer.putString(toRelativePath(data.imagePath, baseDir));
+				writer.put(uint32_t(data.repeat.x));
+				writer.put(uint32_t(data.repeat.y));
+				writer.put(data.parallaxFactor.x);
+				writer.put(data.parallaxFactor.y);
+				writer.put(uint32_t(data.transparentColor.size()));
+				writer.putArray(data.transparentColor.data(), data.transparentColor.size());
+			}
+		}
+		if(!writer.good()) {
+			util::ERR("Failed to write baked map file: \"" + filename + "\"!");
+		}
+	}
+
+	MapData read(const MappedFile& file) {
+		const auto baseDir = std::filesystem::path(file.getFilename()).parent_path();
+		Reader reader(file.getData(), file.getSize());
+		const auto header = reader.get<Header>();
+		if(std::memcmp(header.magic, MAGIC, 4) != 0) {
+			util::ERR("Not a baked map file: \"" + file.getFilename() + "\"!");
+		}
+		if(header.version != VERSION) {
+			util::ERR("Baked map file \"" + file.getFilename() + "\" has version " + std::to_string(header.version)
+				+ ", expected version " + std::to_string(VERSION) + ". Bake the map again!");
+		}
+
+		MapData res;
+		res.mapSize = {header.mapSize[0], header.mapSize[1]};
+		res.tileSize = {header.tileSize[0], header.tileSize[1]};
+		res.tileOrigin = {header.tileOrigin[0], header.tileOrigin[1]};
+		res.bounds = glm::vec4(header.bounds[0], header.bounds[1], header.bounds[2], header.bounds[3]);
+		res.clearColor = glm::vec4(header.clearColor[0], header.clearColor[1], header.clearColor[2], header.clearColor[3]);
+		res.infinite = header.infinite != 0;
+
+		for(auto i = 0u; i < header.numTilesets; ++i) {
+			TilesetData ts;
+			ts.imagePath = toLoadPath(reader.getString(), baseDir);
+			ts.tileSize.x = reader.get<uint32_t>();
+			ts.tileSize.y = reader.get<uint32_t>();
+			ts.tilesetSize.x = reader.get<uint32_t>();
+			ts.tilesetSize.y = reader.get<uint32_t>();
+			ts.firstGID = reader.get<int32_t>();
+			ts.tileCount = reader.get<int32_t>();
+			res.tilesets.push_back(ts);
+		}
+
+		for(auto i = 0u; i < header.numTileClasses; ++i) {
+			auto name = reader.getString();
+			res.tileClassBits[name] = reader.get<uint32_t>();
+		}
+		const auto classes = reader.getArray<uint32_t>(header.numClassesByTileId);
+		res.classesByTileId.assign(classes, classes + header.numClassesByTileId);
+
+		for(auto i = 0u; i < header.numLayers; ++i) {
+			const auto type = reader.get<uint32_t>();
+			if(type == 0) {
+				TileLayerData data;
+				data.name = reader.getString();
+				data.opacity = reader.get<float>();
+				data.offset.x = reader.get<int32_t>();
+				data.offset.y = reader.get<int32_t>();
+				data.size.x = reader.get<uint32_t>();
+				data.size.y = reader.get<uint32_t>();
+				data.chunks.resize(reader.get<uint32_t>());
+				for(auto& chunk : data.chunks) {
+					chunk.origin.x = reader.get<uint32_t>();
+					chunk.origin.y = reader.get<uint32_t>();
+					chunk.size.x = reader.get<uint32_t>();
+					chunk.size.y = reader.get<uint32_t>();
+					chunk.mappedTiles = reader.getArray<uint32_t>(chunk.size.x*chunk.size.y);
+				}
+				res.layers.push_back({0, res.tileLayers.size()});
+				res.tileLayers.push_back(std::move(data));
+			} else if(type == 1) {
+				ImageLayerData data;
+				data.name = reader.getString();
+				data.opacity = reader.get<float>();
+				data.offset.x = reader.get<int32_t>();
+				data.offset.y = reader.get<int32_t>();
+				data.imagePath = toLoadPath(reader.getString(), baseDir);
+				data.repeat.x = reader.get<uint32_t>();
+				data.repeat.y = reader.get<uint32_t>();
+				data.parallaxFactor.x = reader.get<float>();
+				data.parallaxFactor.y = reader.get<float>();
+				const auto numColors = reader.get<uint32_t>();
+				const auto colors = reader.getArray<float>(numColors);
+				data.transparentColor.assign(colors, colors + numColors);
+				res.layers.push_back({1, res.imageLayers.size()});
+				res.imageLayers.push_back(std::move(data));
+			} else {
+				util::ERR("Unknown layer type in baked map file: \"" + file.getFilename() + "\"!");
+			}
+		}
+		return res;
+	}
+
+} // End - namespace bake
+} // End - namespace map
+} // End - namespace hungerland
@@ -0,0 +1,90 @@
+/*=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+ MIT License
+
+ Copyright (c) 2022 Mikko Romppainen (kajakbros@gmail.com)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
+#include <hungerland/map_loader.h>
+#include <hungerland/map_bake.h>
+#include <hungerland/util.h>
+#include <set>
+
+namespace hungerland {
+namespace map {
+
+	std::shared_ptr<texture::Texture> PreparedMap::createTexture(const std::string& filename) const {
+		auto image = getImage(filename);
+		if(image == 0) {
+			return 0;
+		}
+		return std::make_shared<texture::Texture>(image->size.x, image->size.y, image->channels, image->pixels.data());
+	}
+
+	const ImageData* PreparedMap::getImage(const std::string& filename) const {
+		auto it = images.find(filename);
+		if(it == images.end() || it->second.pixels.empty()) {
+			return 0;
+		}
+		return &it->second;
+	}
+
+	static std::shared_ptr<PreparedMap> prepare(const std::string& mapFilename, DecodeImageFuncType decodeImage, size_t chunkSize) {
+		auto res = std::make_shared<PreparedMap>();
+		res->chunkSize = chunkSize;
+		if(bake::isBakedMap(mapFilename)) {
+			res->bakedFile = std::make_shared<bake::MappedFile>(mapFilename);
+			res->data = bake::read(*res->bakedFile);
+		} else {
+			res->data = loadTmx(mapFilename);
+		}
+		auto& data = res->data;
+
+		// Decode each image in its own task:
+		std::set<std::string> imageFiles;
+		for(const auto& ts : data.tilesets) {
+			imageFiles.insert(ts.imagePath);
+		}
+		for(const auto& layer : data.imageLayers) {
+			if(layer.imagePath.size() > 0) {
+				imageFiles.insert(layer.imagePath);
+			}
+		}
+		std::vector< std::pair<std::string, std::future<ImageData> > > images;
+		for(const auto& filename : imageFiles) {
+			images.push_back({filename, std::async(std::launch::async, decodeImage, filename)});
+		}
+
+		for(auto& image : images) {
+			auto imageData = image.second.get();
+			if(imageData.pixels.empty()) {
+				util::ERR("Failed to decode image file: \"" + image.first + "\"!");
+			}
+			util::INFO("Decoded image: " + image.first);
+			res->images[image.first] = std::move(imageData);
+		}
+		return res;
+	}
+
+	std::future< std::shared_ptr<PreparedMap> > prepareAsync(const std::string& mapFilename, DecodeImageFuncType decodeImage, size_t chunkSize) {
+		return std::async(std::launch::async, prepare, mapFilename, decodeImage, chunkSize);
+	}
+
+} // End - namespace map
+} // End - namespace hungerland
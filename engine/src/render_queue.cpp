@@ -0,0 +1,212 @@
+/*=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+ MIT License
+
+ Copyright (c) 2022 Mikko Romppainen (kajakbros@gmail.com)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
+#include <hungerland/render_queue.h>
+#include <hungerland/map.h>
+#include <hungerland/texture.h>
+#include <hungerland/shader.h>
+#include <string.h>
+#include <assert.h>
+
+namespace hungerland {
+namespace graphics {
+
+	uint64_t CommandList::makeKey(uint8_t layer, float depth, unsigned shaderId, unsigned textureId) {
+		// Map float bits to unsigned integer with same order: flip all bits of negatives, sign bit of positives.
+		uint32_t depthBits;
+		memcpy(&depthBits, &depth, sizeof(depthBits));
+		depthBits = (depthBits & 0x80000000u) ? ~depthBits : (depthBits | 0x80000000u);
+		return (uint64_t(layer) << 56)
+			| (uint64_t(depthBits >> 16) << 40)
+			| (uint64_t(shaderId & 0xffffu) << 24)
+			| uint64_t(textureId & 0xffffffu);
+	}
+
+	void CommandList::drawSprite(uint8_t layer, float depth, const glm::mat4& projection, const texture::Texture& texture, const glm::mat4& transform,
+								 const glm::vec4& uvRect, const glm::vec4& tint, const shader::Shader* shader) {
+		const auto textureId = texture.getId();
+		m_commands.push_back({makeKey(layer, depth, shader != 0 ? shader->getId() : 0, textureId), Type::SPRITE, uint32_t(m_sprites.size())});
+		m_sprites.push_back({shader, textureId, addProjection(projection), {transform[0], transform[1], transform[3], uvRect, tint}});
+	}
+
+	void CommandList::drawMap(uint8_t layer, float depth, const map::Map& map, const glm::mat4& projection, const glm::vec2& cameraDelta) {
+		m_commands.push_back({makeKey(layer, depth, 0, 0), Type::MAP, uint32_t(m_maps.size())});
+		m_maps.push_back({&map, projection, cameraDelta});
+	}
+
+	void CommandList::execute(uint8_t layer, float depth, ExecuteFunc func) {
+		m_commands.push_back({makeKey(layer, depth, 0, 0), Type::EXECUTE, uint32_t(m_executes.size())});
+		m_executes.push_back(std::move(func));
+	}
+
+	void CommandList::append(const CommandList& other) {
+		const auto spriteOffset = uint32_t(m_sprites.size());
+		const auto mapOffset = uint32_t(m_maps.size());
+		const auto executeOffset = uint32_t(m_executes.size());
+		const auto projectionOffset = uint32_t(m_projections.size());
+		m_commands.reserve(m_commands.size() + other.m_commands.size());
+		for(auto command : other.m_commands) {
+			switch(command.type) {
+				case Type::SPRITE:	command.index += spriteOffset; break;
+				case Type::MAP:		command.index += mapOffset; break;
+				case Type::EXECUTE:	command.index += executeOffset; break;
+			}
+			m_commands.push_back(command);
+		}
+		m_sprites.reserve(m_sprites.size() + other.m_sprites.size());
+		for(auto sprite : other.m_sprites) {
+			sprite.projection += projectionOffset;
+			m_sprites.push_back(sprite);
+		}
+		m_maps.insert(m_maps.end(), other.m_maps.begin(), other.m_maps.end());
+		m_executes.insert(m_executes.end(), other.m_executes.begin(), other.m_executes.end());
+		m_projections.insert(m_projections.end(), other.m_projections.begin(), other.m_projections.end());
+	}
+
+	void CommandList::clear() {
+		// Keep capacity for the next frame
+		m_commands.clear();
+		m_sprites.clear();
+		m_maps.clear();
+		m_executes.clear();
+		m_projections.clear();
+	}
+
+	size_t CommandList::size() const {
+		return m_commands.size();
+	}
+
+	bool CommandList::empty() const {
+		return m_commands.empty();
+	}
+
+	uint32_t CommandList::addProjection(const glm::mat4& projection) {
+		if(m_projections.empty() || m_projections.back() != projection) {
+			m_projections.push_back(projection);
+		}
+		return uint32_t(m_projections.size() - 1);
+	}
+
+	RenderQueue::RenderQueue(SpriteBatch& spriteBatch)
+		: m_spriteBatch(spriteBatch)
+		, m_numFlushedCommands(0) {
+	}
+
+	void RenderQueue::submit(CommandList&& list) {
+		std::lock_guard<std::mutex> lock(m_submitMutex);
+		if(m_submitted.empty()) {
+			m_submitted = std::move(list);
+		} else {
+			m_submitted.append(list);
+		}
+		list.clear();
+	}
+
+	void RenderQueue::flush() {
+		{
+			std::lock_guard<std::mutex> lock(m_submitMutex);
+			append(m_submitted);
+			m_submitted.clear();
+		}
+		sortCommands();
+
+		// Consecutive sprites with same projection are collected to one batch. The batch keeps the sorted order
+		// and merges runs of same shader and texture to instanced draw calls.
+		bool batching = false;
+		uint32_t batchProjection = 0;
+		auto endBatch = [&]() {
+			if(batching) {
+				m_spriteBatch.end();
+				batching = false;
+			}
+		};
+		for(const auto& command : m_commands) {
+			switch(command.type) {
+				case Type::SPRITE: {
+					const auto& sprite = m_sprites[command.index];
+					if(!batching || m_projections[sprite.projection] != m_projections[batchProjection]) {
+						endBatch();
+						m_spriteBatch.begin(m_projections[sprite.projection], SpriteBatch::SortMode::SUBMISSION);
+						batching = true;
+						batchProjection = sprite.projection;
+					}
+					m_spriteBatch.draw(sprite.textureId, sprite.instance, sprite.shader);
+				} break;
+				case Type::MAP: {
+					endBatch();
+					const auto& m = m_maps[command.index];
+					map::draw(*m.map, m.projection, m.cameraDelta);
+				} break;
+				case Type::EXECUTE:
+					endBatch();
+					m_executes[command.index]();
+					break;
+			}
+		}
+		endBatch();
+		m_numFlushedCommands = m_commands.size();
+		clear();
+	}
+
+	size_t RenderQueue::getNumFlushedCommands() const {
+		return m_numFlushedCommands;
+	}
+
+	void RenderQueue::sortCommands() {
+		// Stable LSD radix sort of 64 bit keys, one byte per pass. Histograms of all passes are counted at once
+		// and passes, where all keys have the same byte, are skipped.
+		const size_t n = m_commands.size();
+		if(n < 2) {
+			return;
+		}
+		size_t counts[8][256] = {};
+		for(const auto& command : m_commands) {
+			for(size_t b = 0; b < 8; ++b) {
+				++counts[b][(command.key >> (8 * b)) & 0xff];
+			}
+		}
+		m_sortBuffer.resize(n);
+		Command* src = m_commands.data();
+		Command* dst = m_sortBuffer.data();
+		for(size_t b = 0; b < 8; ++b) {
+			const auto shift = 8 * b;
+			if(counts[b][(src[0].key >> shift) & 0xff] == n) {
+				continue;
+			}
+			size_t offsets[256];
+			size_t sum = 0;
+			for(size_t i = 0; i < 256; ++i) {
+				offsets[i] = sum;
+				sum += counts[b][i];
+			}
+			for(size_t i = 0; i < n; ++i) {
+				dst[offsets[(src[i].key >> shift) & 0xff]++] = src[i];
+			}
+			std::swap(src, dst);
+		}
+		if(src != m_commands.data()) {
+			m_commands.swap(m_sortBuffer);
+		}
+	}
+}
+}
@@ -24,9 +24,11 @@
 #include <hungerland/shader.h>		// Include class header
 #include <hungerland/util.h>	// Include gl_utils for checkGLError
 #include <hungerland/gl_utils.h>	// Include gl_utils for checkGLError
+#include <hungerland/gl_state.h>
 #include <glad/gl.h>
 #include <stdio.h>			// Include stdio.h, which contains printf-function
 #include <assert.h>
+#include <algorithm>
 
 namespace hungerland {
 namespace shader {
@@ -54,58 +56,137 @@ namespace shader {
 	ShaderPass::ShaderPass(const Shader& shader) : m_shader(shader) {
 	}
 
+	const Uniform* ShaderPass::find(const std::string& name, unsigned type) const {
+		auto uniform = m_shader.findUniform(name);
+		// Uniforms of other types are not set. Samplers are set as ints.
+		assert(uniform == 0 || uniform->type == type || type == GL_INT);
+		return uniform;
+	}
+
 	void ShaderPass::setUniformv(const std::string& name, const std::vector<float>& v){
-		GLint loc = glGetUniformLocation(m_shader.getId(), name.c_str());
-		if (loc < 0) {
-			return; // Don't set the uniform value, if it not found
-		}
 		if(v.size()==1){
-			glUniform1f(loc, v[0]);
+			setUniform(name, v[0]);
 		} else if(v.size()==2){
-			glUniform2f(loc, v[0], v[1]);
+			setUniform(name, v[0], v[1]);
 		} else if(v.size()==3){
-			glUniform3f(loc, v[0], v[1], v[2]);
+			setUniform(name, v[0], v[1], v[2]);
 		} else if(v.size()==4){
-			glUniform4f(loc, v[0], v[1], v[2], v[3]);
+			setUniform(name, v[0], v[1], v[2], v[3]);
 		}
-		checkGLError();
 	}
 
 	void ShaderPass::setUniform(const std::string& name, float v) {
-		setUniformv(name,{v});
+		setUniform(find(name, GL_FLOAT), v);
 	}
 
 	void ShaderPass::setUniform(const std::string& name, float x, float y) {
-		setUniformv(name,{x,y});
+		setUniform(find(name, GL_FLOAT_VEC2), x, y);
 	}
 
 	void ShaderPass::setUniform(const std::string& name, float x, float y, float z) {
-		setUniformv(name,{x,y,z});
+		setUniform(find(name, GL_FLOAT_VEC3), x, y, z);
 	}
 
 	void ShaderPass::setUniform(const std::string& name, float x, float y, float z, float w) {
-		setUniformv(name,{x,y,z,w});
+		setUniform(find(name, GL_FLOAT_VEC4), x, y, z, w);
 	}
 
 	void ShaderPass::setUniformm(const std::string& name, const float* m, bool transposed) {
-		GLint loc = glGetUniformLocation(m_shader.getId(), name.c_str());
-		if (loc < 0) {
+		setUniformm(find(name, GL_FLOAT_MAT4), m, transposed);
+	}
+
+	void ShaderPass::setUniform(const std::string& name, int value) {
+		setUniform(find(name, GL_INT), value);
+	}
+
+	void ShaderPass::setUniformArray(const std::string& name, const int* values, size_t count) {
+		setUniformArray(find(name, GL_INT), values, count);
+	}
+
+	void ShaderPass::setUniformArray2(const std::string& name, const float* values, size_t count) {
+		setUniformArray2(find(name, GL_FLOAT_VEC2), values, count);
+	}
+
+	void ShaderPass::setUniform(const Uniform* uniform, float v) {
+		if (uniform == 0) {
 			return; // Don't set the uniform value, if it not found
 		}
-		glUniformMatrix4fv(loc, 1, transposed ? GL_TRUE:GL_FALSE, m);
+		assert(uniform->type == GL_FLOAT);
+		glstate::countCalls();
+		glUniform1f(uniform->location, v);
 		checkGLError();
 	}
 
-	void ShaderPass::setUniform(const std::string& name, int value) {
-		GLint loc = glGetUniformLocation(m_shader.getId(), name.c_str());
-		if (loc < 0) {
+	void ShaderPass::setUniform(const Uniform* uniform, float x, float y) {
+		if (uniform == 0) {
+			return; // Don't set the uniform value, if it not found
+		}
+		assert(uniform->type == GL_FLOAT_VEC2);
+		glstate::countCalls();
+		glUniform2f(uniform->location, x, y);
+		checkGLError();
+	}
+
+	void ShaderPass::setUniform(const Uniform* uniform, float x, float y, float z) {
+		if (uniform == 0) {
+			return; // Don't set the uniform value, if it not found
+		}
+		assert(uniform->type == GL_FLOAT_VEC3);
+		glstate::countCalls();
+		glUniform3f(uniform->location, x, y, z);
+		checkGLError();
+	}
+
+	void ShaderPass::setUniform(const Uniform* uniform, float x, float y, float z, float w) {
+		if (uniform == 0) {
+			return; // Don't set the uniform value, if it not found
+		}
+		assert(uniform->type == GL_FLOAT_VEC4);
+		glstate::countCalls();
+		glUniform4f(uniform->location, x, y, z, w);
+		checkGLError();
+	}
+
+	void ShaderPass::setUniformm(const Uniform* uniform, const float* m, bool transposed) {
+		if (uniform == 0) {
+			return; // Don't set the uniform value, if it not found
+		}
+		assert(uniform->type == GL_FLOAT_MAT4);
+		glstate::countCalls();
+		glUniformMatrix4fv(uniform->location, 1, transposed ? GL_TRUE:GL_FALSE, m);
+		checkGLError();
+	}
+
+	void ShaderPass::setUniform(const Uniform* uniform, int value) {
+		if (uniform == 0) {
 			return; // Don't set the uniform value, if it not found
 		}
-		glUniform1i(loc, value);
+		// Samplers are set as ints
+		glstate::countCalls();
+		glUniform1i(uniform->location, value);
 		checkGLError();
 	}
 
-	Shader::Shader(const std::string& vertexShaderString, const std::string& fragmentShaderString)
+	void ShaderPass::setUniformArray(const Uniform* uniform, const int* values, size_t count) {
+		if (uniform == 0 || count == 0) {
+			return; // Don't set the uniform value, if it not found
+		}
+		glstate::countCalls();
+		glUniform1iv(uniform->location, GLsizei(std::min<size_t>(count, uniform->size)), values);
+		checkGLError();
+	}
+
+	void ShaderPass::setUniformArray2(const Uniform* uniform, const float* values, size_t count) {
+		if (uniform == 0 || count == 0) {
+			return; // Don't set the uniform value, if it not found
+		}
+		assert(uniform->type == GL_FLOAT_VEC2);
+		glstate::countCalls();
+		glUniform2fv(uniform->location, GLsizei(std::min<size_t>(count, uniform->size)), values);
+		checkGLError();
+	}
+
+	Shader::Shader(const std::string& vertexShaderString, const std::string& fragmentShaderString, PreLinkFunc preLink)
 		: m_shaderProgram(0) {
 		checkGLError();
 		// Create and compile vertex shader
@@ -154,6 +235,9 @@ namespace shader {
 		checkGLError();
 		glAttachShader(m_shaderProgram, fragmentShader);
 		checkGLError();
+		if(preLink) {
+			preLink(m_shaderProgram);
+		}
 		glLinkProgram(m_shaderProgram);
 		checkGLError();
 		// check for linking errors
@@ -171,24 +255,84 @@ namespace shader {
 		checkGLError();
 		glDeleteShader(fragmentShader);
 		checkGLError();
+		reflect();
+	}
+
+	Shader::Shader(unsigned linkedProgram)
+		: m_shaderProgram(linkedProgram) {
+		assert(m_shaderProgram != 0);
+		reflect();
+	}
+
+	void Shader::reflect() {
+		// Active uniforms of the default block
+		GLint numUniforms = 0;
+		glGetProgramiv(m_shaderProgram, GL_ACTIVE_UNIFORMS, &numUniforms);
+		checkGLError();
+		char name[256];
+		for(GLint i = 0; i < numUniforms; ++i) {
+			GLsizei length = 0;
+			GLint size = 0;
+			GLenum type = 0;
+			glGetActiveUniform(m_shaderProgram, GLuint(i), sizeof(name), &length, &size, &type, name);
+			checkGLError();
+			Uniform uniform;
+			uniform.location = glGetUniformLocation(m_shaderProgram, name);
+			if(uniform.location < 0) {
+				continue; // Uniform is in an uniform block
+			}
+			// Samplers are set with glUniform1i
+			const bool isSampler = type == GL_SAMPLER_2D || type == GL_SAMPLER_2D_ARRAY || type == GL_UNSIGNED_INT_SAMPLER_2D
+				|| type == GL_INT_SAMPLER_2D || type == GL_SAMPLER_3D || type == GL_SAMPLER_CUBE;
+			uniform.type = isSampler ? GL_INT : type;
+			uniform.size = size;
+			std::string uniformName(name, length);
+			m_uniforms[uniformName] = uniform;
+			if(uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0) {
+				m_uniforms[uniformName.substr(0, uniformName.size() - 3)] = uniform;
+			}
+		}
+
+		// Uniform blocks shared between shaders are bound to fixed binding points
+		GLint numBlocks = 0;
+		glGetProgramiv(m_shaderProgram, GL_ACTIVE_UNIFORM_BLOCKS, &numBlocks);
+		checkGLError();
+		for(GLint i = 0; i < numBlocks; ++i) {
+			GLsizei length = 0;
+			glGetActiveUniformBlockName(m_shaderProgram, GLuint(i), sizeof(name), &length, name);
+			checkGLError();
+			const std::string blockName(name, length);
+			if(blockName == "FrameData") {
+				glUniformBlockBinding(m_shaderProgram, GLuint(i), FRAME_DATA_BINDING);
+			} else if(blockName == "LayerData") {
+				glUniformBlockBinding(m_shaderProgram, GLuint(i), LAYER_DATA_BINDING);
+			} else {
+				util::WARN("Unknown uniform block: \"" + blockName + "\"");
+			}
+			checkGLError();
+		}
+	}
+
+	const Uniform* Shader::findUniform(const std::string& name) const {
+		auto it = m_uniforms.find(name);
+		return it != m_uniforms.end() ? &it->second : 0;
 	}
 
 	Shader::~Shader() {
 		assert(m_shaderProgram != 0);
 		// Delete shader program
-		glDeleteProgram(m_shaderProgram);
+		glstate::deleteProgram(m_shaderProgram);
 		//checkGLError();
 	}
 
 	void Shader::use(RenderFunc render) const {
 		assert(m_shaderProgram != 0);
-		glUseProgram(m_shaderProgram);
+		// Program stays in use, so consecutive passes of the same shader do not rebind it
+		glstate::useProgram(m_shaderProgram);
 		checkGLError();
 		auto pass = ShaderPass(*this);
 		render(pass);
 		checkGLError();
-		glUseProgram(0);
-		checkGLError();
 	}
 
 	unsigned Shader::getId() const {
@@ -0,0 +1,278 @@
+/*=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+ MIT License
+
+ Copyright (c) 2022 Mikko Romppainen (kajakbros@gmail.com)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
+#include <hungerland/shader.h>
+#include <hungerland/util.h>
+#include <hungerland/gl_utils.h>
+#include <hungerland/gl_state.h>
+#include <glad/gl.h>
+#include <GLFW/glfw3.h>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+#include <cstring>
+#include <stdio.h>
+
+namespace hungerland {
+namespace shader {
+	namespace {
+		// Program binaries are GL 4.1 / ARB_get_program_binary, which are not part of the GL 3.3 loader
+		typedef void (GLAD_API_PTR *GetProgramBinaryFunc)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+		typedef void (GLAD_API_PTR *ProgramBinaryFunc)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+		typedef void (GLAD_API_PTR *ProgramParameteriFunc)(GLuint program, GLenum pname, GLint value);
+		const GLenum PROGRAM_BINARY_RETRIEVABLE_HINT = 0x8257;
+		const GLenum PROGRAM_BINARY_LENGTH = 0x8741;
+		const GLenum NUM_PROGRAM_BINARY_FORMATS = 0x87FE;
+
+		const uint32_t BINARY_MAGIC = 0x42504c48; // "HLPB"
+		const uint32_t BINARY_VERSION = 2;
+
+		// Programs are keyed by hash of the sources. Length and a second hash of the sources are checked on lookup,
+		// so that a hash collision or a stale binary file does not return a program of other sources.
+		struct SourceKey {
+			uint64_t hash;
+			uint64_t checkHash;
+			uint64_t length;
+
+			bool operator==(const SourceKey& other) const {
+				return hash == other.hash && checkHash == other.checkHash && length == other.length;
+			}
+		};
+
+		struct BinaryHeader {
+			uint32_t magic;
+			uint32_t version;
+			SourceKey source;
+			uint64_t driverHash;	// Binaries are valid only for the same driver
+			uint32_t format;
+			uint32_t length;
+		};
+
+		struct CacheEntry {
+			SourceKey key;
+			Shader::Ref shader;
+		};
+
+		struct Cache {
+			std::mutex mutex;
+			std::unordered_map<uint64_t, CacheEntry> shaders;
+			std::string directory;
+			bool binariesChecked = false;
+			GetProgramBinaryFunc getProgramBinary = 0;
+			ProgramBinaryFunc programBinary = 0;
+			ProgramParameteriFunc programParameteri = 0;
+			uint64_t driverHash = 0;
+		};
+
+		Cache& getCache() {
+			static Cache cache;
+			return cache;
+		}
+
+		const uint64_t FNV_OFFSET = 14695981039346656037ull;
+
+		uint64_t fnv1a(uint64_t hash, const void* data, size_t size) {
+			const auto bytes = static_cast<const uint8_t*>(data);
+			for(size_t i = 0; i < size; ++i) {
+				hash ^= bytes[i];
+				hash *= 1099511628211ull;
+			}
+			return hash;
+		}
+
+		// Polynomial hash, which is independent of FNV-1a
+		uint64_t polynomialHash(uint64_t hash, const std::string& str) {
+			for(auto c : str) {
+				hash = hash * 0x9e3779b97f4a7c15ull + uint8_t(c) + 1;
+			}
+			return hash;
+		}
+
+		SourceKey getSourceKey(const std::string& vertexShaderString, const std::string& fragmentShaderString) {
+			SourceKey key;
+			key.hash = hashSource(vertexShaderString, fragmentShaderString);
+			key.checkHash = polynomialHash(polynomialHash(0, vertexShaderString) * 31 + 1, fragmentShaderString);
+			key.length = (uint64_t(vertexShaderString.size()) << 32) | uint64_t(fragmentShaderString.size());
+			return key;
+		}
+
+		// Program binary functions are loaded on first use, when the context is current
+		void loadBinaryFunctions(Cache& cache) {
+			if(cache.binariesChecked) {
+				return;
+			}
+			cache.binariesChecked = true;
+			GLint major = 0;
+			GLint minor = 0;
+			glGetIntegerv(GL_MAJOR_VERSION, &major);
+			glGetIntegerv(GL_MINOR_VERSION, &minor);
+			const bool supported = major > 4 || (major == 4 && minor >= 1) || glfwExtensionSupported("GL_ARB_get_program_binary");
+			if(!supported) {
+				util::INFO("Program binaries not supported, shaders are compiled on each launch");
+				return;
+			}
+			GLint numFormats = 0;
+			glGetIntegerv(NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+			checkGLError();
+			if(numFormats <= 0) {
+				util::INFO("Driver has no program binary formats, shaders are compiled on each launch");
+				return;
+			}
+			cache.getProgramBinary = (GetProgramBinaryFunc)glfwGetProcAddress("glGetProgramBinary");
+			cache.programBinary = (ProgramBinaryFunc)glfwGetProcAddress("glProgramBinary");
+			cache.programParameteri = (ProgramParameteriFunc)glfwGetProcAddress("glProgramParameteri");
+			cache.driverHash = FNV_OFFSET;
+			for(auto name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+				auto str = reinterpret_cast<const char*>(glGetString(name));
+				if(str != 0) {
+					cache.driverHash = fnv1a(cache.driverHash, str, strlen(str));
+				}
+			}
+		}
+
+		std::string getBinaryFilename(const Cache& cache, uint64_t hash) {
+			char name[32];
+			snprintf(name, sizeof(name), "%016llx.glbin", (unsigned long long)hash);
+			return (std::filesystem::path(cache.directory) / name).string();
+		}
+
+		Shader::Ref loadBinary(const Cache& cache, const SourceKey& key) {
+			std::ifstream file(getBinaryFilename(cache, key.hash), std::ios::binary);
+			if(!file) {
+				return 0;
+			}
+			BinaryHeader header;
+			if(!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != BINARY_MAGIC
+			   || header.version != BINARY_VERSION || !(header.source == key) || header.driverHash != cache.driverHash) {
+				return 0;
+			}
+			std::vector<char> binary(header.length);
+			if(!file.read(binary.data(), binary.size())) {
+				return 0;
+			}
+			GLuint program = glCreateProgram();
+			checkGLError();
+			cache.programBinary(program, header.format, binary.data(), GLsizei(binary.size()));
+			// Driver may reject binaries after updates: clear the error and compile from source
+			clearGLErrors();
+			GLint success = 0;
+			glGetProgramiv(program, GL_LINK_STATUS, &success);
+			if(!success) {
+				glstate::deleteProgram(program);
+				return 0;
+			}
+			return std::make_shared<Shader>(program);
+		}
+
+		void saveBinary(const Cache& cache, const SourceKey& key, const Shader& shader) {
+			GLint length = 0;
+			glGetProgramiv(shader.getId(), PROGRAM_BINARY_LENGTH, &length);
+			checkGLError();
+			if(length <= 0) {
+				return;
+			}
+			BinaryHeader header = {BINARY_MAGIC, BINARY_VERSION, key, cache.driverHash, 0, 0};
+			std::vector<char> binary(length);
+			GLsizei written = 0;
+			GLenum format = 0;
+			cache.getProgramBinary(shader.getId(), length, &written, &format, binary.data());
+			checkGLError();
+			header.format = format;
+			header.length = uint32_t(written);
+			std::error_code ec;
+			std::filesystem::create_directories(cache.directory, ec);
+			std::ofstream file(getBinaryFilename(cache, key.hash), std::ios::binary | std::ios::trunc);
+			if(!file.write(reinterpret_cast<const char*>(&header), sizeof(header)) || !file.write(binary.data(), written)) {
+				util::WARN("Failed to write program binary to: \"" + cache.directory + "\"");
+			}
+		}
+	}
+
+	uint64_t hashSource(const std::string& vertexShaderString, const std::string& fragmentShaderString) {
+		// Separator keeps "ab"+"c" and "a"+"bc" apart
+		const char separator = 0;
+		auto hash = fnv1a(FNV_OFFSET, vertexShaderString.data(), vertexShaderString.size());
+		hash = fnv1a(hash, &separator, 1);
+		return fnv1a(hash, fragmentShaderString.data(), fragmentShaderString.size());
+	}
+
+	Shader::Ref getCached(const std::string& vertexShaderString, const std::string& fragmentShaderString) {
+		auto& cache = getCache();
+		const auto key = getSourceKey(vertexShaderString, fragmentShaderString);
+		std::lock_guard<std::mutex> lock(cache.mutex);
+		auto it = cache.shaders.find(key.hash);
+		if(it != cache.shaders.end()) {
+			if(it->second.key == key) {
+				return it->second.shader;
+			}
+			// Other sources with the same hash keep the cache entry, these are compiled without caching
+			util::WARN("Shader source hash collision, compiling program without cache");
+			return std::make_shared<Shader>(vertexShaderString, fragmentShaderString);
+		}
+		Shader::Ref shader;
+		bool useBinaries = false;
+		if(!cache.directory.empty()) {
+			loadBinaryFunctions(cache);
+			useBinaries = cache.programBinary != 0 && cache.getProgramBinary != 0 && cache.programParameteri != 0;
+		}
+		if(useBinaries) {
+			shader = loadBinary(cache, key);
+		}
+		if(shader == 0) {
+			Shader::PreLinkFunc preLink = 0;
+			if(useBinaries) {
+				// Without the hint some drivers return empty or unusable binaries
+				preLink = [&cache](unsigned program) {
+					cache.programParameteri(program, PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+					checkGLError();
+				};
+			}
+			shader = std::make_shared<Shader>(vertexShaderString, fragmentShaderString, preLink);
+			if(useBinaries) {
+				saveBinary(cache, key, *shader);
+			}
+		}
+		cache.shaders[key.hash] = {key, shader};
+		return shader;
+	}
+
+	void setCacheDirectory(const std::string& directory) {
+		auto& cache = getCache();
+		std::lock_guard<std::mutex> lock(cache.mutex);
+		cache.directory = directory;
+	}
+
+	void clearCache() {
+		auto& cache = getCache();
+		std::lock_guard<std::mutex> lock(cache.mutex);
+		cache.shaders.clear();
+		// Next context may be different driver
+		cache.binariesChecked = false;
+		cache.getProgramBinary = 0;
+		cache.programBinary = 0;
+		cache.programParameteri = 0;
+		cache.driverHash = 0;
+	}
+}
+}
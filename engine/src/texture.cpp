@@ -23,21 +23,23 @@
 =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
 #include <hungerland/texture.h>
 #include <hungerland/gl_utils.h>
+#include <hungerland/gl_state.h>
 #include <glad/gl.h>
 #include <stdio.h>
 #include <assert.h>
+#include <utility>
 
 namespace hungerland {
 namespace texture {
     Texture::Texture(/*unsigned width, unsigned height, unsigned nrChannels*/)
-    : m_textureId(-1), m_width(0), m_height(0), m_nrChannels(0) {
+    : m_textureId(-1), m_width(0), m_height(0), m_nrChannels(0), m_bytesPerChannel(1) {
         // Create texture
         glGenTextures(1, &m_textureId);
         checkGLError();
     }
 
     Texture::Texture(unsigned width, unsigned height, unsigned nrChannels, const GLubyte* data)
-    : m_textureId(-1), m_width(width), m_height(height), m_nrChannels(nrChannels) {
+    : m_textureId(-1), m_width(width), m_height(height), m_nrChannels(nrChannels), m_bytesPerChannel(1) {
         // Create texture
         glGenTextures(1, &m_textureId);
         checkGLError();
@@ -45,7 +47,15 @@ namespace texture {
     }
 
     Texture::Texture(unsigned width, unsigned height, unsigned nrChannels, const float* data)
-    : m_textureId(-1), m_width(width), m_height(height), m_nrChannels(nrChannels) {
+    : m_textureId(-1), m_width(width), m_height(height), m_nrChannels(nrChannels), m_bytesPerChannel(1) {
+        // Create texture
+        glGenTextures(1, &m_textureId);
+        checkGLError();
+        setData(width, height, nrChannels,  data);
+    }
+
+    Texture::Texture(unsigned width, unsigned height, unsigned nrChannels, const uint32_t* data)
+    : m_textureId(-1), m_width(width), m_height(height), m_nrChannels(nrChannels), m_bytesPerChannel(1) {
         // Create texture
         glGenTextures(1, &m_textureId);
         checkGLError();
@@ -53,13 +63,13 @@ namespace texture {
     }
 
     Texture::Texture(unsigned width, unsigned height, bool isDepthTexture)
-    : m_textureId(-1), m_width(width), m_height(height), m_nrChannels(4) {
+    : m_textureId(-1), m_width(width), m_height(height), m_nrChannels(4), m_bytesPerChannel(1) {
         // Create texture
         glGenTextures(1, &m_textureId);
         checkGLError();
 
         // Bind it for use
-        glBindTexture(GL_TEXTURE_2D, m_textureId);
+        glstate::bindTexture(GL_TEXTURE_2D, m_textureId);
         checkGLError();
         if (isDepthTexture) {
             glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
@@ -70,11 +80,10 @@ namespace texture {
         }
         setRepeat(false);
         setFiltering(false);
-        glBindTexture(GL_TEXTURE_2D, 0);
     }
 
     Texture::~Texture() {
-        glDeleteTextures(1, &m_textureId);
+        glstate::deleteTexture(m_textureId);
         //checkGLError();
     }
 
@@ -82,34 +91,77 @@ namespace texture {
         m_width = width;
         m_height = height;
         m_nrChannels = nrChannels;
+        m_bytesPerChannel = 4;
         // Bind it for use
-        glBindTexture(GL_TEXTURE_2D, m_textureId);
+        glstate::bindTexture(GL_TEXTURE_2D, m_textureId);
         checkGLError();
         // set the texture data as float RGBA
         glTexImage2D(GL_TEXTURE_2D, 0, nrChannels == 3 ? GL_RGB32F : GL_RGBA32F, width, height, 0, nrChannels == 3 ? GL_RGB : GL_RGBA, GL_FLOAT, data);
         checkGLError();
         setRepeat(false);
         setFiltering(false);
-        glBindTexture(GL_TEXTURE_2D, 0);
     }
 
     void Texture::setData(unsigned width, unsigned height, unsigned nrChannels, const uint8_t* data) {
         m_width = width;
         m_height = height;
         m_nrChannels = nrChannels;
+        m_bytesPerChannel = 1;
         // Bind it for use
-        glBindTexture(GL_TEXTURE_2D, m_textureId);
+        glstate::bindTexture(GL_TEXTURE_2D, m_textureId);
         checkGLError();
         // set the texture data as byte RGBA
         glTexImage2D(GL_TEXTURE_2D, 0, nrChannels == 3 ? GL_RGB : GL_RGBA, width, height, 0, nrChannels == 3 ? GL_RGB : GL_RGBA, GL_UNSIGNED_BYTE, data);
         checkGLError();
         setRepeat(false);
         setFiltering(false);
-        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    void Texture::setData(unsigned width, unsigned height, unsigned nrChannels, const uint32_t* data) {
+        assert(nrChannels == 1 || nrChannels == 2 || nrChannels == 4);
+        m_width = width;
+        m_height = height;
+        m_nrChannels = nrChannels;
+        m_bytesPerChannel = 4;
+        // Bind it for use
+        glstate::bindTexture(GL_TEXTURE_2D, m_textureId);
+        checkGLError();
+        // set the texture data as unsigned integers. Integer textures are sampled with texelFetch.
+        static const GLint internalFormats[] = {0, GL_R32UI, GL_RG32UI, 0, GL_RGBA32UI};
+        static const GLenum formats[] = {0, GL_RED_INTEGER, GL_RG_INTEGER, 0, GL_RGBA_INTEGER};
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormats[nrChannels], width, height, 0, formats[nrChannels], GL_UNSIGNED_INT, data);
+        checkGLError();
+        setRepeat(false);
+        setFiltering(false);
+    }
+
+    void Texture::setSubData(unsigned x, unsigned y, unsigned width, unsigned height, unsigned nrChannels, const uint8_t* data) {
+        assert(x + width <= m_width && y + height <= m_height);
+        glstate::bindTexture(GL_TEXTURE_2D, m_textureId);
+        checkGLError();
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, nrChannels == 3 ? GL_RGB : GL_RGBA, GL_UNSIGNED_BYTE, data);
+        checkGLError();
+    }
+
+    void Texture::setSubData(unsigned x, unsigned y, unsigned width, unsigned height, unsigned nrChannels, const float* data) {
+        assert(x + width <= m_width && y + height <= m_height);
+        glstate::bindTexture(GL_TEXTURE_2D, m_textureId);
+        checkGLError();
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, nrChannels == 3 ? GL_RGB : GL_RGBA, GL_FLOAT, data);
+        checkGLError();
+    }
+
+    void Texture::setSubData(unsigned x, unsigned y, unsigned width, unsigned height, unsigned nrChannels, const uint32_t* data) {
+        assert(x + width <= m_width && y + height <= m_height);
+        static const GLenum formats[] = {0, GL_RED_INTEGER, GL_RG_INTEGER, 0, GL_RGBA_INTEGER};
+        glstate::bindTexture(GL_TEXTURE_2D, m_textureId);
+        checkGLError();
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, formats[nrChannels], GL_UNSIGNED_INT, data);
+        checkGLError();
     }
 
     void Texture::setRepeat(bool repeat) {
-        glBindTexture(GL_TEXTURE_2D, m_textureId);
+        glstate::bindTexture(GL_TEXTURE_2D, m_textureId);
         checkGLError();
         if(repeat) {
             // set the texture wrapping options to repeat
@@ -124,11 +176,10 @@ namespace texture {
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
             checkGLError();
         }
-        glBindTexture(GL_TEXTURE_2D, 0);
     }
 
     void Texture::setFiltering(bool filter) {
-        glBindTexture(GL_TEXTURE_2D, m_textureId);
+        glstate::bindTexture(GL_TEXTURE_2D, m_textureId);
         checkGLError();
         if(filter) {
             // set the texture filltering options to linear
@@ -143,16 +194,27 @@ namespace texture {
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
             checkGLError();
         }
-        glBindTexture(GL_TEXTURE_2D, 0);
     }
 
     void Texture::bind(unsigned textureIndex) {
-        glActiveTexture(GL_TEXTURE0 + textureIndex);
-        checkGLError();
-        glBindTexture(GL_TEXTURE_2D, m_textureId);
+        glstate::bindTexture(textureIndex, GL_TEXTURE_2D, m_textureId);
         checkGLError();
     }
 
+    void Texture::swap(Texture& other) {
+        std::swap(m_textureId, other.m_textureId);
+        std::swap(m_width, other.m_width);
+        std::swap(m_height, other.m_height);
+        std::swap(m_nrChannels, other.m_nrChannels);
+        std::swap(m_bytesPerChannel, other.m_bytesPerChannel);
+    }
+
+    size_t Texture::getSizeInBytes() const {
+        // Drivers store RGB textures as RGBA
+        const size_t texelChannels = m_nrChannels == 3 ? 4 : m_nrChannels;
+        return size_t(m_width) * m_height * texelChannels * m_bytesPerChannel;
+    }
+
     unsigned Texture::getId() const {
         return m_textureId;
     }
@@ -164,5 +226,57 @@ namespace texture {
     unsigned Texture::getHeight() const {
         return m_height;
     }
+
+    TextureArray::TextureArray(unsigned width, unsigned height, unsigned numLayers)
+    : m_textureId(-1), m_width(width), m_height(height), m_numLayers(numLayers) {
+        // Create texture
+        glGenTextures(1, &m_textureId);
+        checkGLError();
+        glstate::bindTexture(GL_TEXTURE_2D_ARRAY, m_textureId);
+        checkGLError();
+        // Allocate all layers without initial data. Padding of layers smaller than the array is never sampled.
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, numLayers, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        checkGLError();
+        // Tiles are pixel art: nearest filtering and no wrapping into the padding
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        checkGLError();
+    }
+
+    TextureArray::~TextureArray() {
+        glstate::deleteTexture(m_textureId);
+    }
+
+    void TextureArray::setLayerData(unsigned layer, unsigned width, unsigned height, const uint8_t* rgba) {
+        assert(layer < m_numLayers && width <= m_width && height <= m_height);
+        glstate::bindTexture(GL_TEXTURE_2D_ARRAY, m_textureId);
+        checkGLError();
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+        checkGLError();
+    }
+
+    void TextureArray::bind(unsigned textureIndex) {
+        glstate::bindTexture(textureIndex, GL_TEXTURE_2D_ARRAY, m_textureId);
+        checkGLError();
+    }
+
+    unsigned TextureArray::getId() const {
+        return m_textureId;
+    }
+
+    unsigned TextureArray::getWidth() const {
+        return m_width;
+    }
+
+    unsigned TextureArray::getHeight() const {
+        return m_height;
+    }
+
+    unsigned TextureArray::getNumLayers() const {
+        return m_numLayers;
+    }
 }
 }
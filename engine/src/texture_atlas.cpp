@@ -0,0 +1,191 @@
+/*=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+ MIT License
+
+ Copyright (c) 2022 Mikko Romppainen (kajakbros@gmail.com)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
+#include <hungerland/texture_atlas.h>
+#include <hungerland/util.h>
+#include <algorithm>
+#include <limits>
+#include <assert.h>
+
+namespace hungerland {
+namespace texture {
+
+	TextureAtlas::TextureAtlas(unsigned pageSize, unsigned padding)
+		: m_pageSize(pageSize)
+		, m_padding(padding) {
+	}
+
+	TextureAtlas::~TextureAtlas() {
+	}
+
+	AtlasRegion TextureAtlas::add(unsigned width, unsigned height, unsigned nrChannels, const uint8_t* data) {
+		assert(nrChannels >= 1 && nrChannels <= 4);
+		assert(data != 0);
+		const unsigned paddedWidth = width + 2 * m_padding;
+		const unsigned paddedHeight = height + 2 * m_padding;
+
+		// Copy image as RGBA into the center of the padded image and clamp coordinates to the image for the padding
+		m_padded.resize(size_t(paddedWidth) * paddedHeight * 4);
+		for(unsigned py = 0; py < paddedHeight; ++py) {
+			const unsigned sy = unsigned(std::min(std::max(int(py) - int(m_padding), 0), int(height) - 1));
+			for(unsigned px = 0; px < paddedWidth; ++px) {
+				const unsigned sx = unsigned(std::min(std::max(int(px) - int(m_padding), 0), int(width) - 1));
+				const uint8_t* src = &data[(size_t(sy) * width + sx) * nrChannels];
+				uint8_t* dst = &m_padded[(size_t(py) * paddedWidth + px) * 4];
+				if(nrChannels >= 3) {
+					dst[0] = src[0];
+					dst[1] = src[1];
+					dst[2] = src[2];
+				} else {
+					// Grey or grey with alpha
+					dst[0] = dst[1] = dst[2] = src[0];
+				}
+				dst[3] = (nrChannels == 4 || nrChannels == 2) ? src[nrChannels - 1] : 0xff;
+			}
+		}
+
+		AtlasRegion region;
+		region.width = width;
+		region.height = height;
+		if(paddedWidth > m_pageSize || paddedHeight > m_pageSize) {
+			util::WARN("Image of size " + std::to_string(width) + "x" + std::to_string(height) + " does not fit to atlas page. Using own texture.");
+			region.texture = std::make_shared<Texture>(paddedWidth, paddedHeight, 4, m_padded.data());
+			region.x = m_padding;
+			region.y = m_padding;
+			region.uvRect = glm::vec4(float(m_padding) / paddedWidth, float(m_padding) / paddedHeight,
+									  float(m_padding + width) / paddedWidth, float(m_padding + height) / paddedHeight);
+			return region;
+		}
+
+		// First page with room for the image
+		Page* page = 0;
+		size_t nodeIndex = 0;
+		unsigned y = 0;
+		for(auto& p : m_pages) {
+			if(findPosition(p, paddedWidth, paddedHeight, nodeIndex, y)) {
+				page = &p;
+				break;
+			}
+		}
+		if(page == 0) {
+			page = &createPage();
+			bool found = findPosition(*page, paddedWidth, paddedHeight, nodeIndex, y);
+			assert(found);
+			(void)found;
+		}
+		const unsigned x = page->skyline[nodeIndex].x;
+		addSkylineLevel(*page, nodeIndex, y, paddedWidth, paddedHeight);
+		page->texture->setSubData(x, y, paddedWidth, paddedHeight, 4, m_padded.data());
+
+		const float scale = 1.0f / float(m_pageSize);
+		region.texture = page->texture;
+		region.x = x + m_padding;
+		region.y = y + m_padding;
+		region.uvRect = glm::vec4(region.x * scale, region.y * scale, (region.x + width) * scale, (region.y + height) * scale);
+		return region;
+	}
+
+	size_t TextureAtlas::getNumPages() const {
+		return m_pages.size();
+	}
+
+	const Texture::Ref& TextureAtlas::getPage(size_t index) const {
+		return m_pages[index].texture;
+	}
+
+	bool TextureAtlas::findPosition(const Page& page, unsigned width, unsigned height, size_t& nodeIndex, unsigned& y) const {
+		// Skyline bottom-left: lowest top edge, then narrowest skyline node
+		unsigned bestBottom = std::numeric_limits<unsigned>::max();
+		unsigned bestWidth = std::numeric_limits<unsigned>::max();
+		bool found = false;
+		const auto& skyline = page.skyline;
+		for(size_t i = 0; i < skyline.size(); ++i) {
+			const unsigned x = skyline[i].x;
+			if(x + width > m_pageSize) {
+				break;
+			}
+			// Image rests on the highest node below it
+			unsigned top = 0;
+			unsigned widthLeft = width;
+			for(size_t j = i; widthLeft > 0; ++j) {
+				assert(j < skyline.size());
+				top = std::max(top, skyline[j].y);
+				widthLeft -= std::min(widthLeft, skyline[j].width);
+			}
+			if(top + height > m_pageSize) {
+				continue;
+			}
+			if(top + height < bestBottom || (top + height == bestBottom && skyline[i].width < bestWidth)) {
+				bestBottom = top + height;
+				bestWidth = skyline[i].width;
+				nodeIndex = i;
+				y = top;
+				found = true;
+			}
+		}
+		return found;
+	}
+
+	void TextureAtlas::addSkylineLevel(Page& page, size_t nodeIndex, unsigned y, unsigned width, unsigned height) {
+		auto& skyline = page.skyline;
+		const unsigned x = skyline[nodeIndex].x;
+		skyline.insert(skyline.begin() + nodeIndex, {x, y + height, width});
+
+		// Shrink or remove nodes covered by the new node
+		const unsigned right = x + width;
+		for(size_t i = nodeIndex + 1; i < skyline.size();) {
+			auto& node = skyline[i];
+			if(node.x >= right) {
+				break;
+			}
+			const unsigned nodeRight = node.x + node.width;
+			if(nodeRight <= right) {
+				skyline.erase(skyline.begin() + i);
+				continue;
+			}
+			node.width = nodeRight - right;
+			node.x = right;
+			break;
+		}
+
+		// Merge neighbouring nodes of same height
+		for(size_t i = 0; i + 1 < skyline.size();) {
+			if(skyline[i].y == skyline[i + 1].y) {
+				skyline[i].width += skyline[i + 1].width;
+				skyline.erase(skyline.begin() + i + 1);
+			} else {
+				++i;
+			}
+		}
+	}
+
+	TextureAtlas::Page& TextureAtlas::createPage() {
+		Page page;
+		page.texture = std::make_shared<Texture>(m_pageSize, m_pageSize, false);
+		page.skyline.push_back({0, 0, m_pageSize});
+		m_pages.push_back(std::move(page));
+		util::INFO("Created texture atlas page " + std::to_string(m_pages.size()) + " of size " + std::to_string(m_pageSize) + "x" + std::to_string(m_pageSize));
+		return m_pages.back();
+	}
+}
+}
@@ -0,0 +1,105 @@
+/*=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+ MIT License
+
+ Copyright (c) 2022 Mikko Romppainen (kajakbros@gmail.com)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
+#include <hungerland/texture_manager.h>
+#include <hungerland/util.h>
+
+namespace hungerland {
+namespace texture {
+
+	TextureManager::TextureManager(LoadFunc load, size_t budgetBytes)
+		: m_load(load) {
+		m_stats.budgetBytes = budgetBytes;
+	}
+
+	TextureManager::~TextureManager() {
+	}
+
+	Texture::Ref TextureManager::get(const std::string& filename) {
+		auto it = m_entries.find(filename);
+		if(it != m_entries.end()) {
+			// Move to front
+			m_lru.splice(m_lru.begin(), m_lru, it->second);
+			++m_stats.hits;
+			return it->second->texture;
+		}
+		++m_stats.misses;
+		auto texture = m_load(filename);
+		if(texture == 0) {
+			return 0;
+		}
+		const auto bytes = texture->getSizeInBytes();
+		m_lru.push_front({filename, texture, bytes});
+		m_entries[filename] = m_lru.begin();
+		++m_stats.numTextures;
+		m_stats.residentBytes += bytes;
+		if(m_stats.residentBytes > m_stats.budgetBytes) {
+			evict();
+			if(m_stats.residentBytes > m_stats.budgetBytes) {
+				util::WARN("Textures in use take " + std::to_string(m_stats.residentBytes / 1024) + " KiB, which exceeds texture budget of "
+						   + std::to_string(m_stats.budgetBytes / 1024) + " KiB");
+			}
+		}
+		return texture;
+	}
+
+	void TextureManager::setBudget(size_t budgetBytes) {
+		m_stats.budgetBytes = budgetBytes;
+		evict();
+	}
+
+	size_t TextureManager::evict(size_t maxBytes) {
+		size_t released = 0;
+		for(auto it = m_lru.end(); it != m_lru.begin() && m_stats.residentBytes > maxBytes;) {
+			--it;
+			// Only the manager references the texture
+			if(it->texture.use_count() != 1) {
+				continue;
+			}
+			released += it->bytes;
+			m_stats.residentBytes -= it->bytes;
+			--m_stats.numTextures;
+			++m_stats.numEvicted;
+			m_stats.evictedBytes += it->bytes;
+			m_entries.erase(it->filename);
+			it = m_lru.erase(it);
+		}
+		return released;
+	}
+
+	size_t TextureManager::evict() {
+		return evict(m_stats.budgetBytes);
+	}
+
+	void TextureManager::clear() {
+		m_entries.clear();
+		m_lru.clear();
+		m_stats.numTextures = 0;
+		m_stats.residentBytes = 0;
+	}
+
+	const TextureManager::Stats& TextureManager::getStats() const {
+		return m_stats;
+	}
+}
+}
@@ -26,6 +26,9 @@
 #include <hungerland/texture.h>
 #include <hungerland/mesh.h>
 #include <hungerland/engine.h>
+#include <hungerland/gl_state.h>
+#include <hungerland/gl_utils.h>
+#include <hungerland/util.h>
 #include <array>
 #include <glad/gl.h>
 #include <GLFW/glfw3.h>		// Include glfw
@@ -108,7 +111,7 @@ namespace window {
 
 	std::unique_ptr<engine::Engine> g_engine;
 
-	Window::Window(size2d_t size, const std::string& title, bool resizable)
+	Window::Window(size2d_t size, const std::string& title, bool resizable, bool headless)
 		: m_size(size)
 		, m_window(0)
 	{
@@ -116,18 +119,37 @@ namespace window {
 		// Create window and check that creation was succesful.
 
 		glfwWindowHint(GLFW_RESIZABLE, resizable ? GLFW_TRUE : GLFW_FALSE);
+		glfwWindowHint(GLFW_VISIBLE, headless ? GLFW_FALSE : GLFW_TRUE);
+#if HUNGERLAND_GL_CHECKS
+		// Debug context reports errors through KHR_debug
+		glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
+#endif
 		m_window = glfwCreateWindow(int(m_size.x), int(m_size.y), title.c_str(), 0, 0);
+		if(!m_window && headless) {
+			// Software rendering without GLX, for example Mesa OSMesa or EGL
+			for(auto api : {GLFW_OSMESA_CONTEXT_API, GLFW_EGL_CONTEXT_API}) {
+				glfwWindowHint(GLFW_CONTEXT_CREATION_API, api);
+				m_window = glfwCreateWindow(int(m_size.x), int(m_size.y), title.c_str(), 0, 0);
+				if(m_window) {
+					util::INFO(std::string("Created headless context with ") + (api == GLFW_OSMESA_CONTEXT_API ? "OSMesa" : "EGL"));
+					break;
+				}
+			}
+			glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_NATIVE_CONTEXT_API);
+		}
+		glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
 		if (!m_window) {
 			throw std::runtime_error("Failed to create window!");
 			return;
 		}
 
-		// Set current context
+		// Set current context. Headless windows render as fast as possible.
 		glfwMakeContextCurrent(m_window);
-		glfwSwapInterval(1);
+		glfwSwapInterval(headless ? 0 : 1);
 
 		// Load GL functions using glad
 		gladLoadGL(glfwGetProcAddress);
+		initGLErrorChecks();
 
 		// Setup Dear ImGui context
 		IMGUI_CHECKVERSION();
@@ -164,11 +186,25 @@ namespace window {
 		// Query the size of the framebuffer (window content) from glfw.
 		int screenWidth, screenHeight;
 		glfwGetFramebufferSize(m_window, &screenWidth, &screenHeight);
+		if(headless) {
+			// Hidden windows do not own their pixels, so render to textures of the window size
+			screenWidth = int(m_size.x);
+			screenHeight = int(m_size.y);
+			m_offscreen = std::make_unique<graphics::FrameBuffer>();
+			m_offscreen->addColorTexture(0, std::make_shared<texture::Texture>(screenWidth, screenHeight, false));
+			m_offscreen->setDepthTexture(std::make_shared<texture::Texture>(screenWidth, screenHeight, true));
+		}
 		glViewport(0, 0, screenWidth, screenHeight);
 		printf("Viewport: %d, %d\n", screenWidth, screenHeight);
 		m_screen = std::make_unique<screen::FrameBuffer>();
 		m_screen->setScreen(screen::Rect{0.0f, float(screenWidth), 0.0f, float(screenHeight)});
 
+		// Textures loaded by loadTexture are kept within the texture budget
+		m_textureManager = std::make_unique<texture::TextureManager>([](const std::string& filename) -> std::shared_ptr<texture::Texture> {
+			Image image(filename);
+			if(image.data == 0) return 0;
+			return std::make_shared<texture::Texture>(image.size.x, image.size.y, image.bpp, image.data);
+		});
 	}
 
 	Window::~Window() {
@@ -177,13 +213,56 @@ namespace window {
 		ImGui_ImplGlfw_Shutdown();
 		ImGui::DestroyContext();
 
+		// Release GL resources while the context still exists
+		glfwMakeContextCurrent(m_window);
+		m_screen.reset();
+		m_frameCapture.reset();
+		m_offscreen.reset();
+		m_textureLoader.reset();
+		m_atlasRegions.clear();
+		m_atlas.reset();
+		m_textureManager.reset();
+		shader::clearCache();
+
 		// Destroy window
 		glfwDestroyWindow(m_window);
 		m_window = 0;
 	}
 
 	void Window::screenshot(const std::string filename) {
-		m_screenshotFileName = filename;
+		getFrameCapture().requestScreenshot(filename);
+	}
+
+	bool Window::startRecording(const std::string& filename) {
+		glfwMakeContextCurrent(m_window);
+		return getFrameCapture().startRecording(filename);
+	}
+
+	void Window::stopRecording() {
+		if(m_frameCapture != 0) {
+			glfwMakeContextCurrent(m_window);
+			m_frameCapture->stopRecording();
+		}
+	}
+
+	bool Window::isRecording() const {
+		return m_frameCapture != 0 && m_frameCapture->isRecording();
+	}
+
+	bool Window::isHeadless() const {
+		return m_offscreen != 0;
+	}
+
+	const texture::Texture* Window::getOffscreenTexture() const {
+		return m_offscreen != 0 ? &m_offscreen->getTexture(0) : 0;
+	}
+
+	graphics::FrameCapture& Window::getFrameCapture() {
+		if(m_frameCapture == 0) {
+			glfwMakeContextCurrent(m_window);
+			m_frameCapture = std::make_unique<graphics::FrameCapture>();
+		}
+		return *m_frameCapture;
 	}
 
 	bool Window::shouldClose() {
@@ -218,13 +297,52 @@ namespace window {
 
 	std::shared_ptr<texture::Texture> Window::loadTexture(const std::string& filename) {
 		glfwMakeContextCurrent(m_window);
-		auto it = m_textures.find(filename);
-		if(it != m_textures.end()) {
+		return m_textureManager->get(filename);
+	}
+
+	texture::TextureManager& Window::getTextureManager() {
+		return *m_textureManager;
+	}
+
+	texture::AtlasRegion Window::loadAtlasTexture(const std::string& filename) {
+		glfwMakeContextCurrent(m_window);
+		auto it = m_atlasRegions.find(filename);
+		if(it != m_atlasRegions.end()) {
 			return it->second;
 		}
 		Image image(filename);
-		if(image.data == 0) return 0;
-		return m_textures[filename] = std::make_shared<texture::Texture>(image.size.x, image.size.y, image.bpp, image.data);
+		if(image.data == 0) return texture::AtlasRegion();
+		if(m_atlas == 0) {
+			m_atlas = std::make_unique<texture::TextureAtlas>();
+		}
+		return m_atlasRegions[filename] = m_atlas->add(image.size.x, image.size.y, image.bpp, image.data);
+	}
+
+	void Window::resetAtlas() {
+		glfwMakeContextCurrent(m_window);
+		m_atlasRegions.clear();
+		m_atlas.reset();
+	}
+
+	std::shared_ptr<texture::Texture> Window::loadTextureAsync(const std::string& filename) {
+		glfwMakeContextCurrent(m_window);
+		if(m_textureLoader == 0) {
+			m_textureLoader = std::make_unique<texture::TextureLoader>([](const std::string& filename, texture::DecodedImage& image) {
+				int width = 0;
+				int height = 0;
+				int channels = 0;
+				uint8_t* data = stbi_load(filename.c_str(), &width, &height, &channels, 4);
+				if(data == 0) {
+					return false;
+				}
+				image.width = unsigned(width);
+				image.height = unsigned(height);
+				image.pixels.assign(data, data + size_t(width) * height * 4);
+				stbi_image_free(data);
+				return true;
+			});
+		}
+		return m_textureLoader->load(filename);
 	}
 
 	void Window::playSound(const std::string& fileName){
@@ -234,23 +352,50 @@ namespace window {
 
 	void Window::render(RenderFunc renderFunc) {
 		glfwMakeContextCurrent(m_window);
-		int screenWidth, screenHeight;
-		glfwGetFramebufferSize(m_window, &screenWidth, &screenHeight);
-		glViewport(0, 0, screenWidth, screenHeight);
+		int screenWidth = int(m_size.x);
+		int screenHeight = int(m_size.y);
+		if(m_offscreen == 0) {
+			glfwGetFramebufferSize(m_window, &screenWidth, &screenHeight);
+		}
+
+		// Upload textures loaded since the last frame
+		if(m_textureLoader != 0) {
+			m_textureLoader->update();
+		}
+
+		auto renderFrame = [&]() {
+			glViewport(0, 0, screenWidth, screenHeight);
+
+			// Start the Dear ImGui frame
+			ImGui_ImplOpenGL3_NewFrame();
+			ImGui_ImplGlfw_NewFrame();
+			ImGui::NewFrame();
 
-		// Start the Dear ImGui frame
-		ImGui_ImplOpenGL3_NewFrame();
-		ImGui_ImplGlfw_NewFrame();
-		ImGui::NewFrame();
+			// User render
+			renderFunc(*this->m_screen);
+			// Draw commands recorded during the user render
+			m_screen->getRenderQueue().flush();
 
-		// User render
-		renderFunc(*this->m_screen);
-		
-		// Render ImGui
-		ImGui::Render();
-		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+			// Render ImGui. It changes GL state outside of glstate.
+			ImGui::Render();
+			ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+			glstate::invalidate();
 
-		glfwSwapBuffers(m_window);
+			// Read screenshots and recorded frames back asynchronously
+			if(m_frameCapture != 0) {
+				m_frameCapture->capture(screenWidth, screenHeight);
+			}
+		};
+
+		if(m_offscreen != 0) {
+			// Headless: nothing to present, just submit the frame
+			m_offscreen->use(renderFrame);
+			glFlush();
+		} else {
+			renderFrame();
+			glfwSwapBuffers(m_window);
+		}
+		glstate::nextFrame();
 	}
 
 	int Window::run(UpdateFunc updateGame, RenderFunc renderFunc) {
@@ -292,24 +437,6 @@ namespace window {
 			// Update
 			running = updateGame(*this, getDt1());
 
-			// Save screenshot
-			if(m_screenshotFileName.length()>0){
-				int width, height;
-				int channels = 4;
-				glfwGetFramebufferSize(m_window, &width, &height);
-				std::vector<uint8_t> lastFrame;
-				lastFrame.resize(channels*width*height);
-				glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, &lastFrame[0]);
-				for(size_t i=0; i<lastFrame.size(); ++i){
-					if((i%4) == 3){
-						lastFrame[i] = 0xff;
-					}
-				}
-				stbi_flip_vertically_on_write(true);
-				stbi_write_png(m_screenshotFileName.c_str(), width, height, channels, &lastFrame[0], width*channels);
-				stbi_flip_vertically_on_write(false);
-				m_screenshotFileName = "";
-			}
 			// Poll other window events.
 			++frames;
 		}
@@ -0,0 +1,46 @@
+/*=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+ MIT License
+
+ Copyright (c) 2022 Mikko Romppainen (kajakbros@gmail.com)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=*/
+#include <hungerland/map_bake.h>
+#include <hungerland/util.h>
+#include <cstdio>
+
+// Bakes Tiled tmx-maps to binary maps, which can be loaded with hungerland::map::Map without parsing.
+// Usage: hungerland_mapbake <input.tmx> <output.hlmap>
+int main(int argc, char* argv[]) {
+	using namespace hungerland;
+	if(argc != 3) {
+		printf("Usage: %s <input.tmx> <output.hlmap>\n", argv[0]);
+		return 1;
+	}
+	try {
+		auto mapData = map::loadTmx(argv[1]);
+		map::bake::write(mapData, argv[2]);
+		util::INFO("Baked map: " + std::string(argv[2]) + " (version " + std::to_string(map::bake::VERSION) + ")");
+	} catch(const std::exception& e) {
+		// Also errors of tmxlite, filesystem and allocation, which are not reported through util::ERR
+		fprintf(stderr, "%s: %s\n", argv[0], e.what());
+		return 1;
+	}
+	return 0;
+}
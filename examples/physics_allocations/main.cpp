@@ -0,0 +1,110 @@
+// Counts heap allocations of platformer physics steps. Run: PhysicsAllocations [steps]
+#include "../platformer.h"
+#include <hungerland/window.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+	// Allocations are counted only on the thread, which runs the measured steps
+	std::atomic<size_t> numAllocations(0);
+	thread_local bool isCounting = false;
+
+	template<typename F>
+	size_t countAllocations(F f) {
+		numAllocations = 0;
+		isCounting = true;
+		f();
+		isCounting = false;
+		return numAllocations;
+	}
+}
+
+void* operator new(std::size_t size) {
+	if(isCounting) {
+		++numAllocations;
+	}
+	if(void* p = std::malloc(size > 0 ? size : 1)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+	std::free(p);
+}
+
+namespace my_game_app {
+	static const view::Config CONFIG = {
+		{},
+		{"assets/test_world2.tmx"},
+		{"assets/Player/Player_NoAnimation.png"},
+		{}
+	};
+}
+
+int main(int argc, char* argv[]) {
+	using namespace my_game_app;
+	using namespace platformer;
+	using namespace hungerland;
+	typedef model::World<model::Character> Model;
+	typedef map::Map::FixedMapCollision MapCollision;
+
+	const size_t numSteps = argc >= 2 ? std::stoul(argv[1]) : 10000;
+	const float dt = 1.0f / 60.0f;
+
+	// Map needs GL context for its textures and shaders
+	window::Window window({640, 360}, "", false, true);
+	auto world = env::reset<Model>(&window, "PhysicsAllocations", CONFIG);
+	const auto& map = *world.tileMap;
+
+	// Reaction without logging, so that only collision queries and integration are measured
+	auto react = [](const model::Character& old, model::Character body, const MapCollision& collision) {
+		if(collision[0][1].y > 0.0f || collision[2][1].y > 0.0f) {
+			body.velocity.y = 0;
+		}
+		if(collision[1][0].x > 0.0f || collision[1][2].x > 0.0f) {
+			body.velocity.x = -old.velocity.x;
+		}
+		return body;
+	};
+	const auto GRAVITY = glm::vec3(0, config::GY, 0);
+	auto body = world.players[0];
+	body.velocity = glm::vec3(config::VX_MAX, 0, 0);
+
+	const auto integrateAllocations = countAllocations([&]() {
+		for(size_t i = 0; i < numSteps; ++i) {
+			body = env::integrateBody<MapCollision>(body, map, world.collisionLayer, action::isPenetrating<MapCollision>, react, GRAVITY, glm::vec3(0), dt);
+		}
+	});
+
+	// Name based checkCollision returns nested vectors, for comparison
+	size_t numHits = 0;
+	const auto namedAllocations = countAllocations([&]() {
+		for(size_t i = 0; i < numSteps; ++i) {
+			numHits += map.checkCollision("PlatformTiles", body.position, glm::vec3(0.5f)).size();
+		}
+	});
+
+	printf("integrateBody: %zu steps, %zu allocations, %.3f allocations/step\n",
+		numSteps, integrateAllocations, double(integrateAllocations) / double(numSteps));
+	printf("checkCollision by layer name: %zu calls, %zu allocations, %.3f allocations/call\n",
+		numSteps, namedAllocations, double(namedAllocations) / double(numSteps));
+	return integrateAllocations == 0 ? 0 : 1;
+}
@@ -10,12 +10,13 @@
 ///			- env::reset(f,cfg) -> World
 ///			- env::update(f,world,action,dt) -> const World&
 ///			- env::loadScene(f,world,index,cfg)
+///			- env::updateBroadphase(world)
 ///
 ///		- Env Actions	= namespace platformer
-///			- f(character, map, dS, dt) -> character
-///			- action::applyEnv(character,map,dt) -> character
-///         - action::applyForce(character,map,totalForce,dt) -> character
-///			- action::applyImpulse(character,map,totalImpulse,dt) -> character
+///			- f(character, map, layer, dS, dt) -> character
+///			- action::applyEnv(character,map,layer,dt) -> character
+///         - action::applyForce(character,map,layer,totalForce,dt) -> character
+///			- action::applyImpulse(character,map,layer,totalImpulse,dt) -> character
 ///
 ///		- Agent			= namespace: platformer
 ///			- character::update(map,character,action,dt)
@@ -136,55 +137,40 @@ namespace  platformer {
 ///
 namespace env {
 	template<typename MapCollision, typename Map, typename Body, typename PenetrateFunc, typename ReactFunc>
-	auto integrateBody(const Body& oldBody, const Map& map, PenetrateFunc isPenetrating, ReactFunc reactFunc, glm::vec3 F, glm::vec3 I, float dt) {
-		auto collistionLayer = "PlatformTiles";
-		assert(false == isPenetrating(map.checkCollision(collistionLayer,oldBody.position,glm::vec3(0.5f))));
-
-		auto stepEuler = [&](Body body, float dt) {
-			// Integrate velocity from forces and position from velocity:
-			auto i = dt * F;
-			body.velocity += I + i;
-			body.position += body.velocity * dt;
-			return std::make_tuple(body, map.checkCollision(collistionLayer,body.position,glm::vec3(0.5f)));
-		};
+	auto integrateBody(const Body& oldBody, const Map& map, size_t collisionLayer, PenetrateFunc isPenetrating, ReactFunc reactFunc, glm::vec3 F, glm::vec3 I, float dt) {
+		const auto halfSize = glm::vec3(0.5f);
+		// How deep contact probe is pushed into touched tiles to get collision info for reaction:
+		const float CONTACT_PROBE = 0.01f;
 
+		// Integrate velocity from forces:
 		auto b = oldBody;
-		const float TIME_TOL = 0.0001f;
-		while(dt > TIME_TOL) {
-			MapCollision resCollision;
-			auto deltaTime = dt;
-			float usedTime = 0;
-			auto resBody = b;
-			for(size_t i=0; i<4; ++i){
-				const float step = 0.5f*deltaTime;
-				auto [newBody, collision] = stepEuler(b, deltaTime);
-				if(isPenetrating(collision)) {
-					// If collides at first step, set impulse:
-					if(!isPenetrating(resCollision)) {
-						resCollision = collision;
-					}
-					// Adjust delta time to be smaller:
-					deltaTime -= step;
-				} else {
-					// Not collides, adjust delta time to be bigger:
-					usedTime = deltaTime;
-					resBody = newBody;
-					deltaTime += step;
-				}
-				if(deltaTime<=TIME_TOL || deltaTime >= dt ) {
-					break;
-				}
+		b.velocity += I + dt * F;
+		const auto displacement = b.velocity * dt;
+
+		// Sweep x and y movement separately, so that body slides along walls and floors:
+		auto probe = glm::vec3(0);
+		bool hasContact = false;
+		for(int axis = 0; axis < 2; ++axis) {
+			auto d = glm::vec3(0);
+			d[axis] = displacement[axis];
+			if(d[axis] == 0.0f) {
+				continue;
 			}
-			assert(false == isPenetrating(map.checkCollision(collistionLayer,b.position,glm::vec3(0.5f))));
-			b = reactFunc(b, resBody, resCollision);
-			assert(false == isPenetrating(map.checkCollision(collistionLayer,b.position,glm::vec3(0.5f))));
-			if(usedTime<=TIME_TOL) {
-				break;
+			auto hit = map.sweepAABB(collisionLayer, b.position, halfSize, d);
+			b.position = hit.position;
+			if(hit.hit) {
+				hasContact = true;
+				probe -= CONTACT_PROBE * glm::vec3(hit.normal, 0.0f);
 			}
-			I = glm::vec3(0);
-			F = glm::vec3(0);
-			dt -= usedTime;
 		}
+
+		// React to touched tiles:
+		MapCollision collision;
+		if(hasContact) {
+			collision = map.checkCollision(collisionLayer, b.position + probe, halfSize);
+		}
+		b = reactFunc(oldBody, b, collision);
+		assert(false == isPenetrating(map.checkCollision(collisionLayer,b.position,halfSize)));
 		return b;
 	}
 
@@ -232,9 +218,6 @@ namespace react {
 	template<typename MapCollision>
 	void print(MapCollision collisions) {
 		using namespace hungerland;
-		if(collisions.size()==0){
-			collisions = util::gridN<glm::vec3>(3,glm::vec3(-1));
-		}
 		auto to_str = [](float v) {
 			if(v<0.0f){
 				v -= 0.05; // rounding
@@ -343,36 +326,39 @@ namespace react {
 	/// \brief applyEnv
 	/// \param character
 	/// \param map
+	/// \param collisionLayer
 	/// \param dt
 	///
 	template<typename MapCollision, typename Map, typename Character>
-	auto applyEnv(const Character& character, const Map& map, float dt) {
+	auto applyEnv(const Character& character, const Map& map, size_t collisionLayer, float dt) {
 		const auto GRAVITY = glm::vec3(0, config::GY, 0);
-		return env::integrateBody<MapCollision>(character, map, isPenetrating<MapCollision>, react::env<MapCollision,Character>, GRAVITY, glm::vec3(0), dt);
+		return env::integrateBody<MapCollision>(character, map, collisionLayer, isPenetrating<MapCollision>, react::env<MapCollision,Character>, GRAVITY, glm::vec3(0), dt);
 	};
 
 	///
 	/// \brief applyForce
 	/// \param character
 	/// \param map
+	/// \param collisionLayer
 	/// \param totalForce
 	/// \param dt
 	///
 	template<typename MapCollision, typename Map, typename Character>
-	auto applyForce(const Character& character, const Map& map, const glm::vec3& totalForce, float dt){
-		return env::integrateBody<MapCollision>(character, map, isPenetrating<MapCollision>, react::character<MapCollision,Character>, totalForce, glm::vec3(0), dt);
+	auto applyForce(const Character& character, const Map& map, size_t collisionLayer, const glm::vec3& totalForce, float dt){
+		return env::integrateBody<MapCollision>(character, map, collisionLayer, isPenetrating<MapCollision>, react::character<MapCollision,Character>, totalForce, glm::vec3(0), dt);
 	};
 
 	///
 	/// \brief applyImpulse
 	/// \param character
 	/// \param map
+	/// \param collisionLayer
 	/// \param totalImpulse
 	/// \param dt
 	///
 	template<typename MapCollision, typename Map, typename Character>
-	auto applyImpulse(const Character& character, const Map& map, const glm::vec3& totalImpulse, float dt){
-		return env::integrateBody<MapCollision>(character, map, isPenetrating<MapCollision>, react::character<MapCollision,Character>, glm::vec3(0), totalImpulse, dt);
+	auto applyImpulse(const Character& character, const Map& map, size_t collisionLayer, const glm::vec3& totalImpulse, float dt){
+		return env::integrateBody<MapCollision>(character, map, collisionLayer, isPenetrating<MapCollision>, react::character<MapCollision,Character>, glm::vec3(0), totalImpulse, dt);
 	};
 } // End namespace platformer::action
 
@@ -395,17 +381,18 @@ namespace agent {
 	/// \brief update
 	/// \param character
 	/// \param map
+	/// \param collisionLayer Tile layer handle of the map resolved with getLayerIndex.
 	/// \param input
 	/// \param dt
 	///
 	template<typename MapCollision, typename Map, typename Character>
-	auto update(Character character, const Map& map, const Action& action, float dt) {
+	auto update(Character character, const Map& map, size_t collisionLayer, const Action& action, float dt) {
 		using namespace hungerland;
 		const auto V_MAX = glm::vec3(config::SX*config::VX_MAX, config::VY_MAX, 0);
 		const auto A_MAX = glm::vec3(config::SX*config::VX_ACC_GROUND, config::GY, 0);
 
 		// Integrate character movement by GRAVITY:
-		character =  action::applyEnv<MapCollision>(character, map, dt);
+		character =  action::applyEnv<MapCollision>(character, map, collisionLayer, dt);
 
 		// Integrate character movement by totalForce and totalImpulse:
 
@@ -415,12 +402,12 @@ namespace agent {
 				// Gound jump list/right
 				util::INFO("Jump");
 				auto I = glm::vec3(0, config::IY, 0);
-				character = action::applyImpulse<MapCollision>(character, map, I, dt);
+				character = action::applyImpulse<MapCollision>(character, map, collisionLayer, I, dt);
 			} else if(action.wantJump && !character.canJump && character.wallJump) {
 				// Gound jump list/right
 				util::INFO("Wall Jump");
 				auto I = glm::vec3(character.wallJump*config::IY, config::IY, 0);
-				character = action::applyImpulse<MapCollision>(character, map, I, dt);
+				character = action::applyImpulse<MapCollision>(character, map, collisionLayer, I, dt);
 			} else {
 				auto F = glm::vec3(0);
 				if((action.dx < 0 && character.canMoveL)
@@ -440,7 +427,7 @@ namespace agent {
 					F.x -= character.velocity.x * config::VX_BREAK;
 				}
 				// Integrate:
-				character = action::applyForce<MapCollision>(character, map, F, dt);
+				character = action::applyForce<MapCollision>(character, map, collisionLayer, F, dt);
 			}
 		}
 
@@ -489,6 +476,8 @@ namespace camera {
 		assert(minCamY <= maxCamY);
 		camera.position.x = clamp(camera.position.x, minCamX, maxCamX);
 		camera.position.y = clamp(camera.position.y, minCamY, maxCamY);
+		// Keep map chunks around the view resident
+		map->updateChunks(glm::vec2(camera.position.x, camera.position.y), glm::vec2(minCamX, minCamY));
 		hungerland::util::INFO("Camera: pos=<"+std::to_string(camera.position.x)+","+std::to_string(camera.position.y)+">");
 		return camera;
 	};
@@ -498,6 +487,8 @@ namespace camera {
 
 
 #include <hungerland/map.h>
+#include <hungerland/broadphase.h>
+#include <hungerland/map_loader.h>
 
 namespace platformer {
 ///
@@ -514,36 +505,24 @@ namespace  env {
 	template<typename World, typename Ctx, typename Config>
 	void loadScene(Ctx* ctx, World& world, size_t index, const Config& cfg) {
 		using namespace hungerland;
-		typedef std::shared_ptr<hungerland::texture::Texture> TexturePtr;
-		std::map<std::string, TexturePtr> textureCache;
-		auto loadTexture = [&textureCache](const std::string& filename, bool black=false) -> TexturePtr{
-			auto hash = filename + (black ? "_black" : "");
-			auto it = textureCache.find(hash);
-			if (it != textureCache.end()) {
-				return it->second;
-			}
-
+		// Decodes images on map loader worker threads:
+		auto decodeImage = [](const std::string& filename) -> map::ImageData {
 			hungerland::window::Image image(filename);
 			assert(image.data != 0);
-			std::vector<uint8_t> imageData;
+			map::ImageData res;
+			res.size = {size_t(image.size.x), size_t(image.size.y)};
+			res.channels = 4;
+			auto& imageData = res.pixels;
 			imageData.resize(image.size.y * image.size.x * 4);
 			bool hasTransparent = false;
 			for (auto y = 0; y < image.size.y; ++y) {
 				for (auto x = 0; x < image.size.x; ++x) {
 					auto id = 4 * unsigned(y * image.size.x + x);
 					auto is = image.bpp * unsigned(y * image.size.x + x);
-					if (black) {
-						imageData[id + 0] = 0;
-						imageData[id + 1] = 0;
-						imageData[id + 2] = 0;
-						imageData[id + 3] = 80;
-					}
-					else {
-						imageData[id + 0] = image.data[is + 0];
-						imageData[id + 1] = image.data[is + 1];
-						imageData[id + 2] = image.data[is + 2];
-						imageData[id + 3] = 0xff;
-					}
+					imageData[id + 0] = image.data[is + 0];
+					imageData[id + 1] = image.data[is + 1];
+					imageData[id + 2] = image.data[is + 2];
+					imageData[id + 3] = 0xff;
 					if (image.data[is + 0] > 0xf0 && image.data[is + 1] <= 0x0f && image.data[is + 2] > 0xf0) {
 						hasTransparent = true;
 						imageData[id + 3] = 0x00;
@@ -551,19 +530,18 @@ namespace  env {
 				}
 			}
 			printf("Loaded image: %s %s transparent pixels\n", filename.c_str(), hasTransparent ? "has" : "has not");
-			//auto texture = std::make_shared<hungerland::texture::Texture>(width, height, 4, &data[0]);
-			TexturePtr texture = std::make_shared<hungerland::texture::Texture>(image.size.x, image.size.y, 4, &imageData[0]);
-			textureCache[hash] = texture;
-			return texture;
+			return res;
 		};
 
-		// Create map layers by map and tileset.
-		world.tileMap = hungerland::map::load<hungerland::map::Map>(loadTexture, cfg.mapFiles[index], false);
+		// Start decoding map and tileset images on worker threads.
+		auto preparedMap = map::prepareAsync(cfg.mapFiles[index], decodeImage);
 
-		// Load object textures
+		// Load object textures. Object and item images are packed to shared atlas textures.
+		// Atlas of the previous scene is released, when the previous world releases its regions.
+		ctx->resetAtlas();
 		for(const auto& filename : cfg.characterTextureFiles) {
-			auto texture = ctx->loadTexture(filename);
-			if(texture== 0) {
+			auto texture = ctx->loadAtlasTexture(filename);
+			if(texture.texture == 0) {
 				util::ERR("Failed to load object texture file: \"" + filename + "\"!");
 			}
 			util::INFO("Loaded object texture: " + filename);
@@ -572,14 +550,19 @@ namespace  env {
 
 		// Load item textures
 		for(const auto& filename : cfg.itemTextureFiles) {
-			auto texture = ctx->loadTexture(filename);
-			if(texture== 0) {
+			auto texture = ctx->loadAtlasTexture(filename);
+			if(texture.texture == 0) {
 				util::ERR("Failed to load item textures: \"" + filename + "\"!");
 			}
 			util::INFO("Loaded item texture: " + filename);
 			world.itemTextures.push_back(texture);
 		}
 
+		// Create map layers by map and tileset, when map is prepared.
+		world.tileMap = map::create<map::Map>(*preparedMap.get(), false);
+		// Resolve collision layer handle once, so that collision queries of bodies do not look it up by name:
+		world.collisionLayer = world.tileMap->getLayerIndex("PlatformTiles");
+
 		// Get map x and y sizes
 		auto mapSize = world.tileMap->getMapSize();
 		// and adjust camera and to center y and left of map.
@@ -607,6 +590,26 @@ namespace  env {
 		return world;
 	};
 
+	///
+	/// \brief updateBroadphase rebuilds broadphase of the world and finds candidate contact pairs.
+	/// Players have ids 0..players.size()-1 and non players ids after them.
+	/// \param world
+	///
+	template<typename World>
+	void updateBroadphase(World& world) {
+		const auto HALF_SIZE = glm::vec2(0.5f);
+		world.broadphase.clear();
+		uint32_t id = 0;
+		for(const auto& player : world.players) {
+			world.broadphase.insert(id++, glm::vec2(player.position), HALF_SIZE);
+		}
+		for(const auto& nonPlayer : world.nonPlayers) {
+			world.broadphase.insert(id++, glm::vec2(nonPlayer.position), HALF_SIZE);
+		}
+		world.broadphase.build();
+		world.broadphase.findPairs(world.contacts);
+	}
+
 	///
 	/// \brief update
 	/// \param ctx
@@ -625,9 +628,12 @@ namespace  env {
 #endif
 		hungerland::util::INFO("Platformer Frame: " + std::to_string(world.frameNum));
 		for(auto& player : world.players){
-			player = agent::update<hungerland::map::Map::MapCollision>(player, *world.tileMap, input, dt);
+			player = agent::update<hungerland::map::Map::FixedMapCollision>(player, *world.tileMap, world.collisionLayer, input, dt);
 		}
+		updateBroadphase(world);
 		world.observer = camera::update(world.observer, world.tileMap, world.players[0].position, dt);
+		// Upload tiles edited during the frame
+		world.tileMap->flushTileEdits();
 		/*printf("Player=<%2.2f, %2.2f> Camera=<%2.2f, %2.2f> Grounded:%d, Topped:%d, Walled:%d \n",
 			   world.player.position.x, world.player.position.y, world.camera.position.x, world.camera.position.y,
 			   world.player.grounded, world.player.topped, world.player.hitWall);*/
@@ -672,20 +678,22 @@ namespace view {
 
 
 		// Offset of half tiles to look at centers of tiles.
-		auto renderMapLayers = [](const hungerland::map::Map& mapLayers, glm::mat4 matProj, const hungerland::size2d_t& sizeInPixels, glm::vec3 cameraPosition) {
+		auto renderMapLayers = [](hungerland::graphics::CommandList& commands, const hungerland::map::Map& mapLayers, glm::mat4 matProj, const hungerland::size2d_t& sizeInPixels, glm::vec3 cameraPosition) {
 			// Flip camera y and offset
 			cameraPosition.y =  mapLayers.getMapSize().y-cameraPosition.y-1;
+			// Map is drawn in Tiled coordinates, which start from the tile origin of infinite maps
+			cameraPosition += glm::vec3(mapLayers.getTileOrigin().x, mapLayers.getTileOrigin().y, 0);
 			// And offset
 			const auto scale = glm::vec3{mapLayers.getTileSize().x, mapLayers.getTileSize().y, 1};
 			const auto mapScreenPos = scale * (cameraPosition + MAP_OFFSET);
 			auto mat = glm::translate(glm::mat4(1), mapScreenPos);
 			matProj = glm::translate(matProj, 0.5f * scale);
 			auto cameraDelta = cameraPosition * scale;
-			hungerland::map::draw(mapLayers, matProj*glm::inverse(mat), cameraDelta);
+			commands.drawMap(0, 0.0f, mapLayers, matProj*glm::inverse(mat), cameraDelta);
 			return matProj;
 		};
 
-		auto renderSprite = [](Screen& screen, const glm::mat4& matProj, const hungerland::size2d_t& sizeInPixels, const glm::vec3& cameraPosition, glm::vec3 position, const hungerland::texture::Texture& texture) {
+		auto renderSprite = [](hungerland::graphics::CommandList& commands, const glm::mat4& matProj, const hungerland::size2d_t& sizeInPixels, const glm::vec3& cameraPosition, glm::vec3 position, const hungerland::texture::AtlasRegion& texture) {
 			// Flip x and y
 			position.x = position.x - cameraPosition.x;
 			position.y = cameraPosition.y - position.y;
@@ -696,16 +704,17 @@ namespace view {
 			auto mat = glm::mat4(1);
 			mat = glm::translate(mat, position);
 			mat = glm::scale(mat, glm::vec3(sizeInPixels.x,sizeInPixels.y, 1));
-			screen.drawSprite(mat, texture);
+			commands.drawSprite(1, 0.0f, matProj, *texture.texture, mat, texture.uvRect);
 		};
 
-		// Render Tilemap
-		projection = renderMapLayers(*state.tileMap, projection, state.tileMap->getTileSize(),
+		// Record draw commands. Queue draws them after render: tilemap on layer 0, sprites on layer 1
+		// with one instanced draw call per texture.
+		auto& commands = screen.getRenderQueue();
+		projection = renderMapLayers(commands, *state.tileMap, projection, state.tileMap->getTileSize(),
 					state.observer.position);
-		// Render Player
-		renderSprite(screen, projection, state.tileMap->getTileSize(),
+		renderSprite(commands, screen.getProjection(), state.tileMap->getTileSize(),
 					state.observer.position,
-					state.players[0].position, *state.characterTextures[0]);
+					state.players[0].position, state.characterTextures[0]);
 	}
 
 
@@ -727,12 +736,15 @@ namespace model {
 	template<typename GameObject>
 	struct World {
 		std::string sceneName;
-		std::vector<std::shared_ptr<hungerland::texture::Texture> > characterTextures;
-		std::vector<std::shared_ptr<hungerland::texture::Texture> > itemTextures;
+		std::vector<hungerland::texture::AtlasRegion> characterTextures;
+		std::vector<hungerland::texture::AtlasRegion> itemTextures;
 		std::shared_ptr<hungerland::map::Map> tileMap;
+		size_t collisionLayer = 0;	// Tile layer handle of tileMap for collisions
 		GameObject observer;
 		std::vector<GameObject> players;
 		std::vector<GameObject> nonPlayers;
+		hungerland::broadphase::SpatialHash broadphase;
+		std::vector<hungerland::broadphase::SpatialHash::Pair> contacts;	// Overlapping object pairs of the last update
 		size_t frameNum = 0;
 	};
 
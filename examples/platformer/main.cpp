@@ -31,9 +31,13 @@ namespace my_game_app {
 	};
 }
 #include <hungerland/window.h>
+#include <hungerland/gl_state.h>
+#include <hungerland/gl_utils.h>
+#include <chrono>
 
-// Main function
-int main() {
+// Main function. Run with --benchmark <frames> to render frames headless without vsync, and optionally
+// with --gl-error-mode <off|get-error|debug-output> to compare GL error check modes of builds with checks.
+int main(int argc, char* argv[]) {
 	using namespace my_game_app;
 	using namespace platformer;
 	using namespace hungerland;
@@ -41,21 +45,70 @@ int main() {
 	typedef model::World<model::Character> Model;
 	typedef window::Window View;
 
+	size_t benchmarkFrames = 0;
+	std::string glErrorMode;
+	for(int i = 1; i + 1 < argc; i += 2) {
+		const std::string option = argv[i];
+		if(option == "--benchmark") {
+			benchmarkFrames = std::stoul(argv[i + 1]);
+		} else if(option == "--gl-error-mode") {
+			glErrorMode = argv[i + 1];
+		}
+	}
+
+	// Store linked shader programs, so that next launches do not compile them again.
+	shader::setCacheDirectory("shader_cache");
 	// Create application window and run it.
-	View window({WINDOW_SIZE_X, WINDOW_SIZE_Y}, "");
+	View window({WINDOW_SIZE_X, WINDOW_SIZE_Y}, "", false, benchmarkFrames > 0);
+	if(glErrorMode == "off") {
+		setGLErrorMode(GLErrorMode::OFF);
+	} else if(glErrorMode == "get-error") {
+		setGLErrorMode(GLErrorMode::GET_ERROR);
+	} else if(glErrorMode == "debug-output") {
+		setGLErrorMode(GLErrorMode::DEBUG_OUTPUT);
+	}
+	// Reported with the frame time, so that runs of builds with and without GL checks can be told apart
+	static const char* GL_ERROR_MODE_NAMES[] = {"off", "get-error", "debug-output"};
+	const std::string glChecks = HUNGERLAND_GL_CHECKS ? GL_ERROR_MODE_NAMES[int(getGLErrorMode())] : "compiled out";
 	auto state = env::reset<Model>(&window, GAME_LONG_NAME, CONFIG);
 	float totalTime = 0;
 	int lastFrame = -1;
+	size_t frame = 0;
+	const auto startTime = std::chrono::steady_clock::now();
 	return window.run([&](View& window, float dt) {
 		totalTime += dt;
+		if(benchmarkFrames > 0) {
+			// Save the last frame as thumbnail and report frame time
+			++frame;
+			if(frame == benchmarkFrames) {
+				window.screenshot("benchmark.png");
+			} else if(frame > benchmarkFrames) {
+				const std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - startTime;
+				printf("Rendered %zu frames in %.3f s, %.3f ms/frame, GL checks: %s\n", frame, seconds.count(), 1000.0 * seconds.count() / double(frame), glChecks.c_str());
+				return false;
+			}
+		}
 		auto& input = window.getInput();
 		if(int(totalTime) > lastFrame){
-			window.setTitle(GAME_LONG_NAME + "    FPS="+std::to_string(1.0f/dt).substr(0,5));
+			const auto& glStats = glstate::getFrameStats();
+			window.setTitle(GAME_LONG_NAME + "    FPS="+std::to_string(1.0f/dt).substr(0,5)
+				+ "    GL calls=" + std::to_string(glStats.glCalls) + " draws=" + std::to_string(glStats.drawCalls));
 			lastFrame = int(totalTime);
 		}
 		if(input.getKeyPressed(window::KEY_F5)) {
 			state = env::reset<Model>(&window, GAME_LONG_NAME, CONFIG);
 		}
+		// Screenshot and frame recording
+		if(input.getKeyPressed(window::KEY_F12)) {
+			window.screenshot("screenshot.png");
+		}
+		if(input.getKeyPressed(window::KEY_F11)) {
+			if(window.isRecording()) {
+				window.stopRecording();
+			} else {
+				window.startRecording("capture.raw");
+			}
+		}
 		// Configure input buttons:
 		agent::Action playerAction;
 		playerAction.dy			= input.getKeyState(window::KEY_UP)				- input.getKeyState(window::KEY_DOWN);